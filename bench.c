@@ -0,0 +1,682 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "graph.h"
+#include "graph_flow.h"
+#include "graph_alloc.h"
+#include "graph_query.h"
+
+/* The benchmarks build their graphs with graph_initialise and graph_connect
+ * from graph.c, so they only work once these functions are implemented.
+ * Every benchmark returns false when it could not measure everything, and
+ * the program then exits with a non-zero status.
+ */
+
+/* Default size of the generated graphs */
+#define BENCH_VERTICES (1u << 20)
+#define BENCH_EDGES    (1u << 22)
+
+/****************************************************************************/
+static double now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/****************************************************************************/
+static uint64_t next_random(uint64_t *state)
+{
+  /* xorshift64 */
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+
+  return *state;
+}
+
+/****************************************************************************/
+static bool
+bench_max_flow(const char *name, const graph_t *graph, unsigned source,
+               unsigned sink, unsigned threads)
+{
+  uint64_t flow = 0;
+  bool *source_side = malloc(graph->vertex_count * sizeof(bool));
+
+  double start = now_ms();
+  bool success = source_side != NULL
+              && graph_max_flow_parallel(graph, source, sink, &flow,
+                                         source_side, threads);
+  double elapsed = now_ms() - start;
+
+  if (success)
+  {
+    unsigned side = 0;
+
+    for (unsigned i = 0; i < graph->vertex_count; i++)
+    {
+      side += source_side[i];
+    }
+
+    printf("%-8s %7u %9u %9u %12llu %9u %9.1f\n", name, threads,
+           graph->vertex_count, graph->edge_count, (unsigned long long) flow,
+           side, elapsed);
+  }
+  else
+  {
+    fprintf(stderr, "%s: max flow failed\n", name);
+  }
+
+  free(source_side);
+
+  return success;
+}
+
+/****************************************************************************/
+static bool bench_flow(int argc, char *argv[])
+{
+  unsigned side = argc > 0 ? strtoul(argv[0], NULL, 0) : 1000;
+  unsigned vertices = argc > 1 ? strtoul(argv[1], NULL, 0) : BENCH_VERTICES;
+  unsigned edges = argc > 2 ? strtoul(argv[2], NULL, 0) : BENCH_EDGES;
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned threads = argc > 3 ? strtoul(argv[3], NULL, 0)
+                   : processors > 0 ? (unsigned) processors : 1;
+  uint64_t state = 88172645463325252ull;
+  graph_t graph;
+  bool success = true;
+
+  if (threads == 0)
+  {
+    threads = 1;
+  }
+  if (side < 2)
+  {
+    side = 2;
+  }
+  if (vertices < 2)
+  {
+    vertices = 2;
+  }
+
+  printf("Max flow: %ux%u grid, random graph with %u vertices, "
+         "global relabelling with 1 and %u threads\n",
+         side, side, vertices, threads);
+  printf("%-8s %7s %9s %9s %12s %9s %9s\n",
+         "graph", "threads", "vertices", "edges", "flow", "cut side", "ms");
+
+  /* Grid with edges in both directions between neighbouring cells, from
+   * the top left to the bottom right corner.
+   */
+  if (graph_initialise(&graph, side * side))
+  {
+    for (unsigned row = 0; row < side; row++)
+    {
+      for (unsigned column = 0; column < side; column++)
+      {
+        unsigned v = row * side + column;
+
+        if (column + 1 < side)
+        {
+          (void) graph_connect(&graph, v, v + 1,
+                               1 + next_random(&state) % 100);
+          (void) graph_connect(&graph, v + 1, v,
+                               1 + next_random(&state) % 100);
+        }
+        if (row + 1 < side)
+        {
+          (void) graph_connect(&graph, v, v + side,
+                               1 + next_random(&state) % 100);
+          (void) graph_connect(&graph, v + side, v,
+                               1 + next_random(&state) % 100);
+        }
+      }
+    }
+
+    success &= bench_max_flow("grid", &graph, 0, side * side - 1, 1);
+    success &= bench_max_flow("grid", &graph, 0, side * side - 1, threads);
+    graph_release(&graph);
+  }
+  else
+  {
+    fprintf(stderr, "graph_initialise() failed\n");
+    success = false;
+  }
+
+  if (graph_initialise(&graph, vertices))
+  {
+    for (unsigned i = 0; i < edges; i++)
+    {
+      uint64_t random = next_random(&state);
+
+      (void) graph_connect(&graph, random % vertices,
+                           (random >> 32) % vertices,
+                           1 + next_random(&state) % 100);
+    }
+
+    success &= bench_max_flow("random", &graph, 0, vertices - 1, 1);
+    success &= bench_max_flow("random", &graph, 0, vertices - 1, threads);
+    graph_release(&graph);
+  }
+  else
+  {
+    fprintf(stderr, "graph_initialise() failed\n");
+    success = false;
+  }
+
+  return success;
+}
+
+/* Hardware events that are counted during the placement benchmark */
+static const struct
+{
+  const char *name;
+  uint64_t config;
+} bench_events[] =
+{
+  { "dTLB miss", PERF_COUNT_HW_CACHE_DTLB
+                 | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                 | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+  { "node miss", PERF_COUNT_HW_CACHE_NODE
+                 | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                 | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+};
+
+#define BENCH_EVENT_COUNT (sizeof(bench_events) / sizeof(bench_events[0]))
+
+/* bench_counters_open()
+ *
+ * Opens a disabled counter for every event in bench_events that counts this
+ * process and the threads it creates later on. A counter that is not
+ * available (no permission, virtual machine, ...) is set to -1.
+ */
+static void bench_counters_open(int fds[])
+{
+  for (size_t i = 0; i < BENCH_EVENT_COUNT; i++)
+  {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = bench_events[i].config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+}
+
+/* bench_node_cpus()
+ *
+ * Stores the CPUs of the given NUMA node in 'cpus', as listed in
+ * /sys/devices/system/node/node<node>/cpulist. Returns false when the list
+ * cannot be read, e.g. on machines without NUMA support.
+ */
+static bool bench_node_cpus(unsigned node, cpu_set_t *cpus)
+{
+  char pathname[64];
+
+  (void) snprintf(pathname, sizeof(pathname),
+                  "/sys/devices/system/node/node%u/cpulist", node);
+
+  FILE *fp = fopen(pathname, "r");
+  if (fp == NULL)
+  {
+    return false;
+  }
+
+  /* The format is a list of ranges such as "0-3,8-11". */
+  unsigned first;
+  unsigned last;
+  int n;
+
+  CPU_ZERO(cpus);
+
+  while ((n = fscanf(fp, "%u-%u", &first, &last)) >= 1)
+  {
+    if (n == 1)
+    {
+      last = first;
+    }
+
+    for (unsigned cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+    {
+      CPU_SET(cpu, cpus);
+    }
+
+    if (fgetc(fp) != ',')
+    {
+      break;
+    }
+  }
+
+  (void) fclose(fp);
+
+  return CPU_COUNT(cpus) > 0;
+}
+
+/* Type representing the work of one thread of the placement benchmark */
+typedef struct bench_scan_s
+{
+  const graph_t *graph;
+  unsigned begin;
+  unsigned end;
+  unsigned node;  /* Node whose CPUs run the thread. */
+  uint64_t sum;
+} bench_scan_t;
+
+/****************************************************************************/
+static void *bench_scan(void *argument)
+{
+  bench_scan_t *scan = argument;
+  const graph_t *graph = scan->graph;
+  uint64_t sum = 0;
+
+  /* Follow every edge and peek at the adjacency list of its head, the
+   * access pattern of a traversal.
+   */
+  for (unsigned i = scan->begin; i < scan->end; i++)
+  {
+    for (edge_t *edge = graph->adjacency_lists[i].first; edge != NULL;
+         edge = edge->next)
+    {
+      sum += edge->weight;
+      sum += graph->adjacency_lists[edge->head].first != NULL;
+    }
+  }
+
+  scan->sum = sum;
+
+  return NULL;
+}
+
+/* bench_placement_run()
+ *
+ * Scans the given graph with 'threads' threads, at least one per vertex
+ * range, and prints one line of results. Range i of 'bounds' is shared by
+ * threads on node nodes[i] (see graph_place_ranges). When nodes is NULL the
+ * threads are spread over all nodes in the same way and share out the
+ * vertices, so that only the placement of the memory differs.
+ */
+static void
+bench_placement_run(const char *name, const graph_t *graph,
+                    const unsigned bounds[], const unsigned nodes[],
+                    unsigned parts, unsigned threads)
+{
+  unsigned node_count = graph_alloc_node_count();
+
+  if (threads < parts)
+  {
+    threads = parts;
+  }
+
+  pthread_t ids[threads];
+  bench_scan_t scans[threads];
+  int fds[BENCH_EVENT_COUNT];
+  uint64_t sum = 0;
+
+  for (unsigned i = 0; i < threads; i++)
+  {
+    /* Threads first .. last - 1 share range 'part'. */
+    unsigned part = (uint64_t) i * parts / threads;
+    unsigned first = ((uint64_t) part * threads + parts - 1) / parts;
+    unsigned last = ((uint64_t) (part + 1) * threads + parts - 1) / parts;
+    uint64_t size = bounds[part + 1] - bounds[part];
+
+    scans[i].graph = graph;
+    scans[i].begin = bounds[part] + size * (i - first) / (last - first);
+    scans[i].end = bounds[part] + size * (i + 1 - first) / (last - first);
+    scans[i].node = nodes != NULL ? nodes[part]
+                  : (uint64_t) i * node_count / threads;
+  }
+
+  bench_counters_open(fds);
+  for (size_t i = 0; i < BENCH_EVENT_COUNT; i++)
+  {
+    if (fds[i] >= 0)
+    {
+      (void) ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  double start = now_ms();
+
+  for (unsigned i = 0; i < threads; i++)
+  {
+    pthread_attr_t attr;
+    cpu_set_t cpus;
+
+    (void) pthread_attr_init(&attr);
+    if (bench_node_cpus(scans[i].node, &cpus))
+    {
+      (void) pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+
+    if (pthread_create(&ids[i], &attr, bench_scan, &scans[i]) != 0)
+    {
+      (void) bench_scan(&scans[i]);
+      ids[i] = pthread_self();
+    }
+    (void) pthread_attr_destroy(&attr);
+  }
+  for (unsigned i = 0; i < threads; i++)
+  {
+    if (! pthread_equal(ids[i], pthread_self()))
+    {
+      (void) pthread_join(ids[i], NULL);
+    }
+    sum += scans[i].sum;
+  }
+
+  double elapsed = now_ms() - start;
+
+  printf("%-22s %9.1f", name, elapsed);
+
+  for (size_t i = 0; i < BENCH_EVENT_COUNT; i++)
+  {
+    uint64_t count;
+
+    if (fds[i] >= 0 && read(fds[i], &count, sizeof(count)) == sizeof(count))
+    {
+      printf(" %12llu", (unsigned long long) count);
+    }
+    else
+    {
+      printf(" %12s", "n/a");
+    }
+
+    if (fds[i] >= 0)
+    {
+      (void) close(fds[i]);
+    }
+  }
+
+  printf("   (checksum %llu)\n", (unsigned long long) sum);
+}
+
+/****************************************************************************/
+static bool bench_placement(int argc, char *argv[])
+{
+  unsigned vertices = argc > 0 ? strtoul(argv[0], NULL, 0) : BENCH_VERTICES;
+  unsigned edges = argc > 1 ? strtoul(argv[1], NULL, 0) : BENCH_EDGES;
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned threads = argc > 2 ? strtoul(argv[2], NULL, 0)
+                   : processors > 0 ? (unsigned) processors : 1;
+  uint64_t state = 88172645463325252ull;
+  graph_t graph;
+  bool success = true;
+
+  static const struct
+  {
+    const char *name;
+    graph_alloc_policy_t policy;
+  } policies[] =
+  {
+    { "default",            { GRAPH_PAGES_DEFAULT, GRAPH_PLACE_FIRST_TOUCH } },
+    { "transparent huge",   { GRAPH_PAGES_TRANSPARENT,
+                              GRAPH_PLACE_FIRST_TOUCH } },
+    { "explicit huge",      { GRAPH_PAGES_EXPLICIT, GRAPH_PLACE_FIRST_TOUCH } },
+    { "interleave",         { GRAPH_PAGES_DEFAULT, GRAPH_PLACE_INTERLEAVE } },
+    { "interleave + huge",  { GRAPH_PAGES_TRANSPARENT,
+                              GRAPH_PLACE_INTERLEAVE } },
+    { "partition",          { GRAPH_PAGES_DEFAULT, GRAPH_PLACE_PARTITION } },
+    { "partition + huge",   { GRAPH_PAGES_TRANSPARENT,
+                              GRAPH_PLACE_PARTITION } },
+  };
+
+  if (vertices == 0)
+  {
+    vertices = 1;
+  }
+  if (threads == 0)
+  {
+    threads = 1;
+  }
+
+  unsigned nodes = graph_alloc_node_count();
+
+  printf("Placement: %u vertices, %u random edges, %u threads pinned to "
+         "%u NUMA node%s\n", vertices, edges, threads, nodes,
+         nodes > 1 ? "s" : " (placement has no effect)");
+  printf("%-22s %9s", "policy", "scan ms");
+  for (size_t i = 0; i < BENCH_EVENT_COUNT; i++)
+  {
+    printf(" %12s", bench_events[i].name);
+  }
+  printf("\n");
+
+  if (! graph_initialise(&graph, vertices))
+  {
+    fprintf(stderr, "graph_initialise() failed\n");
+    return false;
+  }
+
+  for (unsigned i = 0; i < edges; i++)
+  {
+    uint64_t random = next_random(&state);
+
+    if (! graph_connect(&graph, random % vertices,
+                        (random >> 32) % vertices, i & 0xff))
+    {
+      fprintf(stderr, "graph_connect() failed\n");
+      success = false;
+      break;
+    }
+  }
+
+  unsigned bounds[nodes + 1];
+  unsigned range_nodes[nodes];
+
+  bounds[0] = 0;
+  bounds[1] = vertices;
+  bench_placement_run("malloc (graph_connect)", &graph, bounds, NULL, 1,
+                      threads);
+
+  for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+  {
+    graph_t placed;
+
+    if (graph_place(&graph, &placed, &policies[i].policy))
+    {
+      unsigned parts = graph_place_ranges(&placed, bounds, range_nodes);
+      bool partitioned = policies[i].policy.placement == GRAPH_PLACE_PARTITION;
+
+      bench_placement_run(policies[i].name, &placed, bounds,
+                          partitioned ? range_nodes : NULL, parts, threads);
+      graph_place_release(&placed);
+    }
+    else
+    {
+      fprintf(stderr, "%s: out of memory\n", policies[i].name);
+      success = false;
+    }
+  }
+
+  graph_release(&graph);
+
+  return success;
+}
+
+/****************************************************************************/
+static int bench_compare(const void *a, const void *b)
+{
+  double x = *(const double *) a;
+  double y = *(const double *) b;
+
+  return (x > y) - (x < y);
+}
+
+/* bench_latency_print()
+ *
+ * Sorts the given latencies, in microseconds, and prints their median, 99th
+ * percentile and maximum together with the mean result size: vertices for
+ * graph_khop and edges for graph_induced_subgraph.
+ */
+static void bench_latency_print(const char *name, double latencies[],
+                                unsigned count, double mean)
+{
+  qsort(latencies, count, sizeof(double), bench_compare);
+
+  printf("%-18s %9.2f %9.2f %9.2f %12.1f\n", name,
+         latencies[(count - 1) / 2], latencies[(size_t) (count - 1) * 99 / 100],
+         latencies[count - 1], mean);
+}
+
+/****************************************************************************/
+static bool bench_query(int argc, char *argv[])
+{
+  unsigned vertices = argc > 0 ? strtoul(argv[0], NULL, 0) : BENCH_VERTICES;
+  unsigned edges = argc > 1 ? strtoul(argv[1], NULL, 0) : BENCH_EDGES;
+  unsigned queries = argc > 2 ? strtoul(argv[2], NULL, 0) : 10000;
+  unsigned k = argc > 3 ? strtoul(argv[3], NULL, 0) : 3;
+  unsigned fanout = argc > 4 ? strtoul(argv[4], NULL, 0) : 0;
+  uint64_t state = 88172645463325252ull;
+  graph_t graph;
+  graph_query_t query;
+
+  if (vertices == 0)
+  {
+    vertices = 1;
+  }
+  if (queries == 0)
+  {
+    queries = 1;
+  }
+
+  printf("Query latency: %u vertices, %u random edges, %u queries from "
+         "random sources, k = %u, fanout = %u\n",
+         vertices, edges, queries, k, fanout);
+  printf("%-18s %9s %9s %9s %12s\n",
+         "query", "p50 us", "p99 us", "max us", "mean size");
+
+  if (! graph_initialise(&graph, vertices))
+  {
+    fprintf(stderr, "graph_initialise() failed\n");
+    return false;
+  }
+
+  bool success = true;
+
+  for (unsigned i = 0; i < edges; i++)
+  {
+    uint64_t random = next_random(&state);
+
+    if (! graph_connect(&graph, random % vertices,
+                        (random >> 32) % vertices, i & 0xff))
+    {
+      fprintf(stderr, "graph_connect() failed\n");
+      success = false;
+      break;
+    }
+  }
+
+  double *khop = malloc(queries * sizeof(double));
+  double *subgraph = malloc(queries * sizeof(double));
+
+  if (khop != NULL && subgraph != NULL
+      && graph_query_initialise(&query, 1u << 16, (size_t) 1 << 20))
+  {
+    double vertex_total = 0;
+    double edge_total = 0;
+
+    for (unsigned i = 0; i < queries; i++)
+    {
+      unsigned source = next_random(&state) % vertices;
+      double start = now_ms();
+
+      vertex_total += graph_khop(&query, &graph, source, k, fanout);
+
+      double middle = now_ms();
+
+      (void) graph_induced_subgraph(&query, &graph, fanout);
+      edge_total += query.edge_count;
+
+      khop[i] = (middle - start) * 1e3;
+      subgraph[i] = (now_ms() - middle) * 1e3;
+    }
+
+    bench_latency_print("graph_khop", khop, queries,
+                        vertex_total / queries);
+    bench_latency_print("induced_subgraph", subgraph, queries,
+                        edge_total / queries);
+    graph_query_release(&query);
+  }
+  else
+  {
+    fprintf(stderr, "out of memory\n");
+    success = false;
+  }
+
+  free(khop);
+  free(subgraph);
+  graph_release(&graph);
+
+  return success;
+}
+
+/* Type representing a benchmark that can be selected on the command line */
+typedef struct bench_s
+{
+  const char *name;
+  bool (*run)(int argc, char *argv[]);
+} bench_t;
+
+static const bench_t benches[] =
+{
+  { "flow",      bench_flow },
+  { "placement", bench_placement },
+  { "query",     bench_query },
+};
+
+/****************************************************************************/
+int main(int argc, char *argv[])
+{
+  size_t count = sizeof(benches) / sizeof(benches[0]);
+
+  if (argc < 2)
+  {
+    bool success = true;
+
+    /* Run every benchmark with its default parameters */
+    for (size_t i = 0; i < count; i++)
+    {
+      success &= benches[i].run(0, NULL);
+      printf("\n");
+    }
+
+    return success ? 0 : 1;
+  }
+
+  for (size_t i = 0; i < count; i++)
+  {
+    if (strcmp(argv[1], benches[i].name) == 0)
+    {
+      return benches[i].run(argc - 2, argv + 2) ? 0 : 1;
+    }
+  }
+
+  fprintf(stderr, "usage: %s [benchmark [parameters]]\n", argv[0]);
+  fprintf(stderr, "benchmarks:");
+  for (size_t i = 0; i < count; i++)
+  {
+    fprintf(stderr, " %s", benches[i].name);
+  }
+  fprintf(stderr, "\n");
+
+  return 1;
+}
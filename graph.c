@@ -1,6 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "graph.h"
 
@@ -186,3 +190,481 @@ void graph_to_dot(const graph_t *graph, const char *pathname)
     fprintf(fp, "}\n");
   }
 }
+
+/* Number of bytes of a bitmap of removed vertices with the given capacity. */
+#define REMOVED_BITMAP_SIZE(capacity) \
+  (((size_t) (capacity) + CHAR_BIT - 1) / CHAR_BIT)
+
+/***************************************************************************/
+bool graph_add_vertices(graph_t *graph, unsigned n)
+{
+  assert(graph != NULL);
+
+  if (n > UINT_MAX - graph->vertex_count)
+  {
+    return false;
+  }
+
+  unsigned vertex_count = graph->vertex_count + n;
+
+  if (vertex_count > graph->vertex_capacity)
+  {
+    unsigned capacity = graph->vertex_capacity > 0 ? graph->vertex_capacity : 1;
+
+    while (capacity < vertex_count)
+    {
+      capacity = capacity <= UINT_MAX / 2 ? capacity * 2 : UINT_MAX;
+    }
+
+    /* Grow the bitmap of removed vertices and the stack of free identifiers
+     * first, so that a failure leaves the graph unchanged.
+     */
+    if (graph->removed_vertices != NULL)
+    {
+      size_t size = REMOVED_BITMAP_SIZE(graph->vertex_capacity);
+      unsigned char *removed_vertices =
+        realloc(graph->removed_vertices, REMOVED_BITMAP_SIZE(capacity));
+
+      if (removed_vertices == NULL)
+      {
+        return false;
+      }
+      memset(removed_vertices + size, 0, REMOVED_BITMAP_SIZE(capacity) - size);
+      graph->removed_vertices = removed_vertices;
+    }
+
+    if (graph->free_vertices != NULL)
+    {
+      unsigned *free_vertices =
+        realloc(graph->free_vertices, capacity * sizeof(unsigned));
+
+      if (free_vertices == NULL)
+      {
+        return false;
+      }
+      graph->free_vertices = free_vertices;
+    }
+
+    adjacency_list_t *adjacency_lists =
+      realloc(graph->adjacency_lists, capacity * sizeof(adjacency_list_t));
+
+    if (adjacency_lists == NULL)
+    {
+      return false;
+    }
+    graph->adjacency_lists = adjacency_lists;
+    graph->vertex_capacity = capacity;
+  }
+
+  for (size_t i = graph->vertex_count; i < vertex_count; i++)
+  {
+    graph->adjacency_lists[i].first = NULL;
+  }
+  graph->vertex_count = vertex_count;
+
+  return true;
+}
+
+/***************************************************************************/
+bool graph_add_vertex(graph_t *graph, unsigned *id)
+{
+  assert(graph != NULL);
+  assert(id != NULL);
+
+  if (graph->free_vertex_count > 0)
+  {
+    graph->free_vertex_count--;
+    *id = graph->free_vertices[graph->free_vertex_count];
+    graph->removed_vertices[*id / CHAR_BIT] &=
+      (unsigned char) ~(1u << (*id % CHAR_BIT));
+
+    return true;
+  }
+
+  if (graph_add_vertices(graph, 1))
+  {
+    *id = graph->vertex_count - 1;
+
+    return true;
+  }
+
+  return false;
+}
+
+/***************************************************************************/
+bool graph_remove_vertex(graph_t *graph, unsigned id)
+{
+  assert(graph != NULL);
+
+  return graph_remove_vertices(graph, &id, 1);
+}
+
+/***************************************************************************/
+bool graph_remove_vertices(graph_t *graph, const unsigned *ids, unsigned n)
+{
+  assert(graph != NULL);
+  assert(ids != NULL || n == 0);
+
+  if (n == 0)
+  {
+    return true;
+  }
+
+  if (graph->removed_vertices == NULL)
+  {
+    graph->removed_vertices =
+      calloc(REMOVED_BITMAP_SIZE(graph->vertex_capacity), 1);
+
+    if (graph->removed_vertices == NULL)
+    {
+      return false;
+    }
+  }
+
+  if (graph->free_vertices == NULL)
+  {
+    graph->free_vertices = malloc(graph->vertex_capacity * sizeof(unsigned));
+
+    if (graph->free_vertices == NULL)
+    {
+      return false;
+    }
+  }
+
+  /* Mark all vertices first. An identifier that is not a vertex, already
+   * removed or given twice undoes the marks, leaving the graph unchanged.
+   */
+  for (unsigned i = 0; i < n; i++)
+  {
+    unsigned id = ids[i];
+
+    if (! graph_vertex_exists(graph, id))
+    {
+      while (i > 0)
+      {
+        i--;
+        graph->removed_vertices[ids[i] / CHAR_BIT] &=
+          (unsigned char) ~(1u << (ids[i] % CHAR_BIT));
+      }
+
+      return false;
+    }
+
+    graph->removed_vertices[id / CHAR_BIT] |=
+      (unsigned char) (1u << (id % CHAR_BIT));
+  }
+
+  /* Outgoing edges: release the whole adjacency list of every vertex. */
+  for (unsigned i = 0; i < n; i++)
+  {
+    edge_t *edge = graph->adjacency_lists[ids[i]].first;
+
+    while (edge != NULL)
+    {
+      edge_t *next = edge->next;
+
+      free(edge);
+      graph->edge_count--;
+      edge = next;
+    }
+    graph->adjacency_lists[ids[i]].first = NULL;
+  }
+
+  /* Incoming edges: unlink every edge whose head is marked, in one pass
+   * over all adjacency lists for the whole batch.
+   */
+  for (size_t i = 0; i < graph->vertex_count; i++)
+  {
+    edge_t **link = &graph->adjacency_lists[i].first;
+
+    while (*link != NULL)
+    {
+      unsigned head = (*link)->head;
+
+      if (head < graph->vertex_count
+          && (graph->removed_vertices[head / CHAR_BIT]
+              & (1u << (head % CHAR_BIT))))
+      {
+        edge_t *removed = *link;
+
+        *link = removed->next;
+        free(removed);
+        graph->edge_count--;
+      }
+      else
+      {
+        link = &(*link)->next;
+      }
+    }
+  }
+
+  /* Every identifier is on the stack at most once, because a removed vertex
+   * cannot be removed again before graph_add_vertex reuses it.
+   */
+  for (unsigned i = 0; i < n; i++)
+  {
+    graph->free_vertices[graph->free_vertex_count] = ids[i];
+    graph->free_vertex_count++;
+  }
+
+  return true;
+}
+
+/***************************************************************************/
+bool graph_vertex_exists(const graph_t *graph, unsigned id)
+{
+  assert(graph != NULL);
+
+  if (id >= graph->vertex_count)
+  {
+    return false;
+  }
+
+  return graph->removed_vertices == NULL ||
+         ! (graph->removed_vertices[id / CHAR_BIT] & (1u << (id % CHAR_BIT)));
+}
+
+/* Number of vertices that a canonicalization thread claims at a time. */
+#define CANONICALIZE_CHUNK 1024
+
+/* Type representing the work shared by the canonicalization threads. */
+typedef struct canonicalize_s
+{
+  graph_t *graph;
+  graph_merge_policy_t policy;
+  bool remove_self_loops;
+
+  size_t next;      /* First vertex that has not been claimed yet. */
+  unsigned removed; /* Number of edges removed by all threads. */
+} canonicalize_t;
+
+/***************************************************************************/
+static edge_t *merge_sorted(edge_t *left, edge_t *right)
+{
+  edge_t *result = NULL;
+  edge_t **link = &result;
+
+  while (left != NULL && right != NULL)
+  {
+    /* Taking from the left on ties keeps the sort stable. */
+    if (left->head <= right->head)
+    {
+      *link = left;
+      left = left->next;
+    }
+    else
+    {
+      *link = right;
+      right = right->next;
+    }
+    link = &(*link)->next;
+  }
+  *link = left != NULL ? left : right;
+
+  return result;
+}
+
+/* sort_edges()
+ *
+ * Sorts the given linked list of edges by head with a stable merge sort and
+ * returns its new first edge.
+ */
+static edge_t *sort_edges(edge_t *first)
+{
+  if (first == NULL || first->next == NULL)
+  {
+    return first;
+  }
+
+  /* Split the list in the middle. */
+  edge_t *slow = first;
+  edge_t *fast = first->next;
+
+  while (fast != NULL && fast->next != NULL)
+  {
+    slow = slow->next;
+    fast = fast->next->next;
+  }
+
+  edge_t *second = slow->next;
+  slow->next = NULL;
+
+  return merge_sorted(sort_edges(first), sort_edges(second));
+}
+
+/* canonicalize_list()
+ *
+ * Sorts the given adjacency list and merges or removes edges according to
+ * the given policy. Returns the number of removed edges.
+ */
+static unsigned
+canonicalize_list(adjacency_list_t *list, graph_merge_policy_t policy,
+                  bool remove_self_loops)
+{
+  unsigned removed = 0;
+  edge_t *kept = NULL;
+
+  list->first = sort_edges(list->first);
+
+  edge_t **link = &list->first;
+
+  while (*link != NULL)
+  {
+    edge_t *edge = *link;
+
+    if (remove_self_loops && edge->tail == edge->head)
+    {
+      *link = edge->next;
+      free(edge);
+      removed++;
+    }
+    else if (kept != NULL && kept->head == edge->head)
+    {
+      switch (policy)
+      {
+        case GRAPH_MERGE_KEEP_FIRST:
+          break;
+
+        case GRAPH_MERGE_MIN:
+          if (edge->weight < kept->weight)
+          {
+            kept->weight = edge->weight;
+          }
+          break;
+
+        case GRAPH_MERGE_MAX:
+          if (edge->weight > kept->weight)
+          {
+            kept->weight = edge->weight;
+          }
+          break;
+
+        case GRAPH_MERGE_SUM:
+          kept->weight = edge->weight <= UINT_MAX - kept->weight
+                       ? kept->weight + edge->weight : UINT_MAX;
+          break;
+      }
+
+      *link = edge->next;
+      free(edge);
+      removed++;
+    }
+    else
+    {
+      kept = edge;
+      link = &edge->next;
+    }
+  }
+
+  return removed;
+}
+
+/***************************************************************************/
+static void *canonicalize_worker(void *argument)
+{
+  canonicalize_t *work = argument;
+  graph_t *graph = work->graph;
+  unsigned removed = 0;
+
+  for (;;)
+  {
+    size_t begin = __sync_fetch_and_add(&work->next, CANONICALIZE_CHUNK);
+
+    if (begin >= graph->vertex_count)
+    {
+      break;
+    }
+
+    size_t end = graph->vertex_count - begin > CANONICALIZE_CHUNK
+               ? begin + CANONICALIZE_CHUNK : graph->vertex_count;
+
+    for (size_t i = begin; i < end; i++)
+    {
+      removed += canonicalize_list(&graph->adjacency_lists[i], work->policy,
+                                   work->remove_self_loops);
+    }
+  }
+
+  (void) __sync_fetch_and_add(&work->removed, removed);
+
+  return NULL;
+}
+
+/***************************************************************************/
+void graph_canonicalize(graph_t *graph, graph_merge_policy_t policy,
+                        bool remove_self_loops, unsigned thread_count)
+{
+  assert(graph != NULL);
+
+  if (thread_count == 0)
+  {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    thread_count = processors > 0 ? (unsigned) processors : 1;
+  }
+
+  /* No point in starting threads that would not get a chunk. */
+  unsigned chunks = graph->vertex_count / CANONICALIZE_CHUNK + 1;
+
+  if (thread_count > chunks)
+  {
+    thread_count = chunks;
+  }
+
+  canonicalize_t work;
+  work.graph = graph;
+  work.policy = policy;
+  work.remove_self_loops = remove_self_loops;
+  work.next = 0;
+  work.removed = 0;
+
+  pthread_t *threads = malloc((thread_count - 1) * sizeof(pthread_t) + 1);
+  unsigned started = 0;
+
+  if (threads != NULL)
+  {
+    while (started < thread_count - 1
+           && pthread_create(&threads[started], NULL, canonicalize_worker,
+                             &work) == 0)
+    {
+      started++;
+    }
+  }
+
+  /* The calling thread takes part in the work as well. */
+  (void) canonicalize_worker(&work);
+
+  for (unsigned i = 0; i < started; i++)
+  {
+    (void) pthread_join(threads[i], NULL);
+  }
+  free(threads);
+
+  graph->edge_count -= work.removed;
+  graph->sorted = true;
+}
+
+/***************************************************************************/
+bool graph_contains(const graph_t *graph, unsigned tail, unsigned head)
+{
+  assert(graph != NULL);
+
+  if (tail < graph->vertex_count)
+  {
+    const adjacency_list_t *list = &graph->adjacency_lists[tail];
+
+    for (edge_t *edge = list->first; edge != NULL; edge = edge->next)
+    {
+      if (edge->head == head)
+      {
+        return true;
+      }
+      if (graph->sorted && edge->head > head)
+      {
+        break;
+      }
+    }
+  }
+
+  return false;
+}
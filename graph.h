@@ -29,6 +29,30 @@ typedef struct graph_s
    * is indexed by vertex number
    */
   adjacency_list_t *adjacency_lists;
+
+  /* Number of adjacency lists for which memory has been allocated. This is
+   * always at least vertex_count so that vertices can be added without
+   * reallocating the array every time.
+   */
+  unsigned vertex_capacity;
+
+  /* Pointer to the first element of a stack of identifiers of removed
+   * vertices. These identifiers are reused when new vertices are added.
+   * NULL as long as no vertex has been removed.
+   */
+  unsigned *free_vertices;
+  unsigned free_vertex_count; /* Number of identifiers on the stack. */
+
+  /* Pointer to a bitmap with one bit per allocated adjacency list. The bit
+   * of a vertex is set while the vertex is removed (see graph_remove_vertex).
+   * NULL as long as no vertex has been removed.
+   */
+  unsigned char *removed_vertices;
+
+  /* True when every adjacency list is sorted by head and contains at most
+   * one edge per head (see graph_canonicalize).
+   */
+  bool sorted;
 } graph_t;
 
 /* edge_to_string()
@@ -119,6 +143,10 @@ bool list_contains(const adjacency_list_t *list, unsigned head, unsigned tail);
  *  - when the dynamic memory allocation succeeds
  *    - valid memory has been allocated for all the adjacency_lists
  *    - all the member variables are correctly initialised
+ *    - vertex_capacity == vertex_count
+ *    - free_vertices == NULL and free_vertex_count == 0
+ *    - removed_vertices == NULL
+ *    - sorted == false
  *
  * NOTE: Don't forget to initialise each adjacency list !
  */ 
@@ -162,7 +190,8 @@ void graph_print(const graph_t *graph);
 /* graph_release() 
  *
  * Releases the memory that was previously allocated by calls to 
- * graph_initialise and graph_connect on this graph. This function also 
+ * graph_initialise, graph_connect, graph_add_vertices and graph_remove_vertex
+ * on this graph. This function also 
  * updates the member fields of the given graph to represent an empty graph.
  *
  * PRECONDITIONS: 
@@ -175,6 +204,9 @@ void graph_print(const graph_t *graph);
  *  - vertex_count == 0
  *  - edge_count == 0
  *  - adjacency_lists == NULL
+ *  - vertex_capacity == 0
+ *  - free_vertices == NULL and free_vertex_count == 0
+ *  - removed_vertices == NULL
  */
 void graph_release(graph_t *graph);
 
@@ -190,7 +222,8 @@ void graph_release(graph_t *graph);
  * The new edge must be put *in front* of the correct adjacency list.
  *
  * Returns false when the dynamic memory allocation fails or when the vertices
- * do not exist in the graph. Returns true otherwise.
+ * do not exist in the graph, which includes vertices that have been removed
+ * by graph_remove_vertex (see graph_vertex_exists). Returns true otherwise.
  *
  * PRECONDITIONS:
  *  - graph != NULL
@@ -200,7 +233,8 @@ void graph_release(graph_t *graph);
  *
  * POSTCONDITIONS:
  *  - when the dynamic memory allocation succeeds
- *    edge_count reflects the new total number of edges in the given graph
+ *    - edge_count reflects the new total number of edges in the given graph
+ *    - sorted == false
  */
 bool
 graph_connect(graph_t *graph, unsigned tail, unsigned head, unsigned weight);
@@ -286,4 +320,142 @@ void graph_build_from_file(graph_t *graph, const char *pathname);
  */
 void graph_to_dot(const graph_t *graph, const char *pathname);
 
+/* graph_add_vertices()
+ *
+ * Adds n new vertices without any edges to the given graph. The new vertices
+ * get the identifiers vertex_count .. vertex_count + n - 1.
+ *
+ * The array of adjacency lists grows geometrically (its capacity is doubled
+ * whenever it is too small) so that adding vertices one at a time takes
+ * amortized constant time.
+ *
+ * Returns false when the dynamic memory allocation fails or when the number
+ * of vertices would overflow. The graph is left unchanged in that case.
+ * Returns true otherwise.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ *   graph is properly initialised
+ */
+bool graph_add_vertices(graph_t *graph, unsigned n);
+
+/* graph_add_vertex()
+ *
+ * Adds one new vertex without any edges to the given graph and stores its
+ * identifier in the variable pointed to by 'id'. The identifier of a
+ * previously removed vertex is reused when there is one, otherwise the
+ * vertex is appended as by graph_add_vertices.
+ *
+ * Returns false when the dynamic memory allocation fails. Returns true
+ * otherwise.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ *   id != NULL
+ *   graph is properly initialised
+ */
+bool graph_add_vertex(graph_t *graph, unsigned *id);
+
+/* graph_remove_vertex()
+ *
+ * Removes all edges whose tail or head is the vertex with the given
+ * identifier from the given graph and makes the identifier available for
+ * reuse by graph_add_vertex. The identifiers of the other vertices do not
+ * change, hence vertex_count does not change either.
+ *
+ * The outgoing edges are removed in time proportional to the outdegree of
+ * the vertex. The graph keeps no reverse adjacency lists, so finding the
+ * incoming edges takes one pass over all vertices and edges: every call
+ * costs O(vertex_count + edge_count), even for a vertex without incoming
+ * edges. Removing many vertices one at a time is therefore quadratic;
+ * use graph_remove_vertices to remove them in a single pass.
+ *
+ * Returns false when the given id does not represent a vertex in the given
+ * graph, when the vertex has already been removed or when the dynamic memory
+ * allocation fails. Returns true otherwise.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ *
+ * POSTCONDITIONS:
+ *   when true is returned, graph_vertex_exists(graph, id) == false until the
+ *   identifier is reused by graph_add_vertex
+ */
+bool graph_remove_vertex(graph_t *graph, unsigned id);
+
+/* graph_remove_vertices()
+ *
+ * Removes the n vertices whose identifiers are in the array 'ids' as if by
+ * graph_remove_vertex, but finds the incoming edges of all of them in one
+ * pass over all vertices and edges: the whole batch costs
+ * O(vertex_count + edge_count + n) rather than that much per vertex.
+ *
+ * Returns false when one of the identifiers does not represent a vertex in
+ * the given graph, has already been removed or occurs twice in 'ids', or
+ * when the dynamic memory allocation fails. The graph is left unchanged in
+ * that case. Returns true otherwise.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ *   ids != NULL or n == 0
+ */
+bool graph_remove_vertices(graph_t *graph, const unsigned *ids, unsigned n);
+
+/* graph_vertex_exists()
+ *
+ * Returns true if the given id represents a vertex in the given graph, i.e.
+ * id < vertex_count and the vertex has not been removed by
+ * graph_remove_vertex or graph_remove_vertices. Returns false otherwise.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ */
+bool graph_vertex_exists(const graph_t *graph, unsigned id);
+
+/* Policies to merge parallel edges, i.e. edges with the same tail and head,
+ * into one edge (see graph_canonicalize).
+ */
+typedef enum graph_merge_policy_e
+{
+  GRAPH_MERGE_KEEP_FIRST, /* Keep the edge that comes first in the list. */
+  GRAPH_MERGE_MIN,        /* Keep the minimum weight. */
+  GRAPH_MERGE_MAX,        /* Keep the maximum weight. */
+  GRAPH_MERGE_SUM         /* Add the weights, saturating at UINT_MAX. */
+} graph_merge_policy_t;
+
+/* graph_canonicalize()
+ *
+ * Sorts every adjacency list of the given graph by head and merges parallel
+ * edges into one edge whose weight is determined by the given policy. When
+ * remove_self_loops is true, edges whose tail equals their head are removed
+ * as well. The memory of every removed edge is released and edge_count is
+ * updated accordingly.
+ *
+ * The adjacency lists are processed by thread_count threads in parallel, or
+ * by one thread per online processor when thread_count is 0. When threads
+ * cannot be created, the calling thread does the remaining work.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ *   graph is properly initialised
+ *
+ * POSTCONDITIONS:
+ *   sorted == true
+ */
+void graph_canonicalize(graph_t *graph, graph_merge_policy_t policy,
+                        bool remove_self_loops, unsigned thread_count);
+
+/* graph_contains()
+ *
+ * Returns true if the given graph contains an edge with the given tail and
+ * the given head. Returns false otherwise.
+ *
+ * When the graph is sorted, the search stops at the first edge whose head
+ * is larger than the given head.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ */
+bool graph_contains(const graph_t *graph, unsigned tail, unsigned head);
+
 #endif /* DIGRAPH_H */
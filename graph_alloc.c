@@ -0,0 +1,447 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "graph_alloc.h"
+
+/* Size of a huge page. This is the default on x86-64 and the smallest huge
+ * page size on most other architectures, which is all that matters for the
+ * alignment of the allocations below.
+ */
+#define HUGE_PAGE_SIZE ((size_t) 2 << 20)
+
+/* Maximum number of nodes, one bit per node in a node mask. */
+#define MAX_NODES (sizeof(unsigned long) * 8)
+
+/* Type representing the header behind the adjacency lists of a graph that
+ * was placed by graph_place.
+ */
+typedef struct place_header_s
+{
+  size_t size;                 /* Size of the whole allocation. */
+  graph_alloc_policy_t policy; /* Policy of the allocation. */
+  unsigned parts;              /* Number of non-empty vertex ranges. */
+
+  /* Range i is bounds[i] .. bounds[i + 1] - 1 and is placed on node
+   * nodes[i] (see graph_place_ranges).
+   */
+  unsigned bounds[MAX_NODES + 1];
+  unsigned nodes[MAX_NODES];
+} place_header_t;
+
+/* Alignment of the header behind the adjacency lists. */
+#define PLACE_HEADER_ALIGNMENT 64
+
+/***************************************************************************/
+static size_t round_up(size_t size, size_t alignment)
+{
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+/* mapping_size()
+ *
+ * Returns the size of the mapping behind an allocation of the given size.
+ * Huge page allocations are rounded up to a whole number of huge pages.
+ */
+static size_t mapping_size(size_t size, const graph_alloc_policy_t *policy)
+{
+  if (policy->pages == GRAPH_PAGES_DEFAULT)
+  {
+    return size;
+  }
+
+  return round_up(size, HUGE_PAGE_SIZE);
+}
+
+/* page_size()
+ *
+ * Returns the size of the pages behind an allocation with the given policy.
+ * Memory that is bound to different nodes must be split at multiples of it.
+ */
+static size_t page_size(const graph_alloc_policy_t *policy)
+{
+  if (policy->pages == GRAPH_PAGES_DEFAULT)
+  {
+    return sysconf(_SC_PAGESIZE);
+  }
+
+  return HUGE_PAGE_SIZE;
+}
+
+/* place_header()
+ *
+ * Returns the header of a graph that was placed by graph_place.
+ */
+static place_header_t *place_header(const graph_t *placed)
+{
+  size_t lists_size = (size_t) placed->vertex_count * sizeof(adjacency_list_t);
+
+  return (place_header_t *) ((char *) placed->adjacency_lists
+                             + round_up(lists_size, PLACE_HEADER_ALIGNMENT));
+}
+
+/***************************************************************************/
+static void
+set_policy(void *address, size_t size, int mode, unsigned long mask)
+{
+  /* Errors are ignored: without NUMA support the memory simply stays
+   * wherever the operating system puts it.
+   */
+  (void) syscall(SYS_mbind, address, size, mode, &mask, MAX_NODES, 0);
+}
+
+/***************************************************************************/
+unsigned graph_alloc_node_count(void)
+{
+  unsigned result = 1;
+
+  FILE *fp = fopen("/sys/devices/system/node/online", "r");
+  if (fp != NULL)
+  {
+    /* The format is a list of ranges such as "0-1,3". Nodes are assumed to
+     * be numbered from 0, so the count is the highest node plus one.
+     */
+    unsigned first;
+    unsigned last;
+    int n;
+
+    while ((n = fscanf(fp, "%u-%u", &first, &last)) >= 1)
+    {
+      unsigned highest = n == 2 ? last : first;
+
+      if (highest + 1 > result)
+      {
+        result = highest + 1;
+      }
+
+      if (fgetc(fp) != ',')
+      {
+        break;
+      }
+    }
+
+    (void) fclose(fp);
+  }
+
+  return result < MAX_NODES ? result : MAX_NODES;
+}
+
+/***************************************************************************/
+void *graph_alloc_pages(size_t size, const graph_alloc_policy_t *policy)
+{
+  assert(policy != NULL);
+  assert(size > 0);
+
+  size_t length = mapping_size(size, policy);
+  void *address = MAP_FAILED;
+
+  if (policy->pages == GRAPH_PAGES_EXPLICIT)
+  {
+    address = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+
+  if (address == MAP_FAILED && policy->pages != GRAPH_PAGES_DEFAULT)
+  {
+    /* Transparent huge pages need huge page aligned memory. Map one huge
+     * page more than needed and trim the unaligned ends.
+     */
+    char *raw = mmap(NULL, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (raw != MAP_FAILED)
+    {
+      char *aligned = (char *) round_up((uintptr_t) raw, HUGE_PAGE_SIZE);
+      size_t head = aligned - raw;
+
+      if (head > 0)
+      {
+        (void) munmap(raw, head);
+      }
+      (void) munmap(aligned + length, HUGE_PAGE_SIZE - head);
+
+      (void) madvise(aligned, length, MADV_HUGEPAGE);
+      address = aligned;
+    }
+  }
+  else if (policy->pages == GRAPH_PAGES_DEFAULT)
+  {
+    address = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  }
+
+  if (address == MAP_FAILED)
+  {
+    return NULL;
+  }
+
+  unsigned nodes = graph_alloc_node_count();
+
+  if (policy->placement == GRAPH_PLACE_INTERLEAVE && nodes > 1)
+  {
+    unsigned long mask = nodes < MAX_NODES ? (1ul << nodes) - 1 : ~0ul;
+
+    set_policy(address, length, MPOL_INTERLEAVE, mask);
+  }
+
+  return address;
+}
+
+/***************************************************************************/
+void graph_alloc_bind(void *address, size_t size, unsigned node,
+                      const graph_alloc_policy_t *policy)
+{
+  assert(policy != NULL);
+
+  if (size == 0 || node >= MAX_NODES || graph_alloc_node_count() <= 1)
+  {
+    return;
+  }
+
+  size_t page = page_size(policy);
+  uintptr_t begin = (uintptr_t) address / page * page;
+  uintptr_t end = round_up((uintptr_t) address + size, page);
+
+  /* Preferred rather than strict, so that a full node does not make the
+   * allocation fail.
+   */
+  set_policy((void *) begin, end - begin, MPOL_PREFERRED, 1ul << node);
+}
+
+/***************************************************************************/
+void graph_alloc_free_pages(void *address, size_t size,
+                            const graph_alloc_policy_t *policy)
+{
+  assert(policy != NULL);
+
+  if (address != NULL)
+  {
+    (void) munmap(address, mapping_size(size, policy));
+  }
+}
+
+/***************************************************************************/
+bool graph_place(const graph_t *graph, graph_t *placed,
+                 const graph_alloc_policy_t *policy)
+{
+  assert(graph != NULL);
+  assert(placed != NULL);
+  assert(policy != NULL);
+
+  unsigned vertex_count = graph->vertex_count;
+  size_t edge_count = 0;
+
+  for (size_t i = 0; i < vertex_count; i++)
+  {
+    const adjacency_list_t *list = &graph->adjacency_lists[i];
+
+    for (edge_t *edge = list->first; edge != NULL; edge = edge->next)
+    {
+      edge_count++;
+    }
+  }
+
+  /* Split the vertices in one range per node with about the same number of
+   * edges: range i is bounds[i] .. bounds[i + 1] - 1.
+   */
+  unsigned parts = policy->placement == GRAPH_PLACE_PARTITION
+                 ? graph_alloc_node_count() : 1;
+  unsigned bounds[MAX_NODES + 1];
+  size_t edges = 0;
+  unsigned part = 0;
+
+  bounds[0] = 0;
+
+  for (size_t i = 0; i < vertex_count; i++)
+  {
+    const adjacency_list_t *list = &graph->adjacency_lists[i];
+
+    while (part + 1 < parts && edges >= edge_count * (part + 1) / parts)
+    {
+      part++;
+      bounds[part] = i;
+    }
+
+    for (edge_t *edge = list->first; edge != NULL; edge = edge->next)
+    {
+      edges++;
+    }
+  }
+
+  while (part + 1 < parts)
+  {
+    part++;
+    bounds[part] = vertex_count;
+  }
+  bounds[parts] = vertex_count;
+
+  /* Move every bound to the nearest vertex whose adjacency list starts on a
+   * page boundary, so that no page of the lists is shared by two nodes.
+   * Huge pages can only be bound as a whole.
+   */
+  size_t page = page_size(policy);
+  size_t lists_per_page = page / sizeof(adjacency_list_t);
+
+  for (unsigned i = 1; i < parts; i++)
+  {
+    size_t bound = (bounds[i] + lists_per_page / 2)
+                 / lists_per_page * lists_per_page;
+
+    bounds[i] = bound < bounds[i - 1] ? bounds[i - 1]
+              : bound > vertex_count ? vertex_count : bound;
+  }
+
+  size_t part_edges[MAX_NODES];
+
+  for (unsigned i = 0; i < parts; i++)
+  {
+    part_edges[i] = 0;
+
+    for (size_t v = bounds[i]; v < bounds[i + 1]; v++)
+    {
+      const adjacency_list_t *list = &graph->adjacency_lists[v];
+
+      for (edge_t *edge = list->first; edge != NULL; edge = edge->next)
+      {
+        part_edges[i]++;
+      }
+    }
+  }
+
+  /* Layout: adjacency lists, header, then the edges of every range starting
+   * on a page of their own.
+   */
+  size_t lists_size = (size_t) vertex_count * sizeof(adjacency_list_t);
+  size_t part_offsets[MAX_NODES];
+  size_t size = round_up(round_up(lists_size, PLACE_HEADER_ALIGNMENT)
+                         + sizeof(place_header_t), page);
+
+  for (unsigned i = 0; i < parts; i++)
+  {
+    part_offsets[i] = size;
+    size += round_up(part_edges[i] * sizeof(edge_t), page);
+  }
+
+  char *base = graph_alloc_pages(size, policy);
+
+  if (base == NULL)
+  {
+    return false;
+  }
+
+  adjacency_list_t *lists = (adjacency_list_t *) base;
+
+  /* Bind before the first touch, which happens when the copy is made. The
+   * header shares the last page of the lists with the last non-empty range.
+   */
+  if (parts > 1)
+  {
+    for (unsigned i = 0; i < parts; i++)
+    {
+      size_t begin = bounds[i] * sizeof(adjacency_list_t);
+      size_t end = bounds[i + 1] < vertex_count
+                 ? bounds[i + 1] * sizeof(adjacency_list_t) : part_offsets[0];
+
+      if (bounds[i] < bounds[i + 1])
+      {
+        graph_alloc_bind(base + begin, end - begin, i, policy);
+      }
+      graph_alloc_bind(base + part_offsets[i],
+                       round_up(part_edges[i] * sizeof(edge_t), page), i,
+                       policy);
+    }
+  }
+
+  placed->vertex_count = vertex_count;
+  placed->edge_count = edge_count;
+  placed->adjacency_lists = lists;
+  placed->vertex_capacity = vertex_count;
+  placed->free_vertices = NULL;
+  placed->free_vertex_count = 0;
+  placed->removed_vertices = NULL;
+  placed->sorted = graph->sorted;
+
+  place_header_t *header = place_header(placed);
+  header->size = size;
+  header->policy = *policy;
+
+  /* Only keep the non-empty ranges, or one empty range for a graph without
+   * vertices.
+   */
+  header->parts = 0;
+  header->bounds[0] = 0;
+  for (unsigned i = 0; i < parts; i++)
+  {
+    if (bounds[i] < bounds[i + 1] || (i + 1 == parts && header->parts == 0))
+    {
+      header->nodes[header->parts] = i;
+      header->parts++;
+      header->bounds[header->parts] = bounds[i + 1];
+    }
+  }
+
+  for (unsigned i = 0; i < parts; i++)
+  {
+    edge_t *next = (edge_t *) (base + part_offsets[i]);
+
+    for (size_t v = bounds[i]; v < bounds[i + 1]; v++)
+    {
+      edge_t **link = &lists[v].first;
+
+      for (edge_t *edge = graph->adjacency_lists[v].first; edge != NULL;
+           edge = edge->next)
+      {
+        next->tail = edge->tail;
+        next->head = edge->head;
+        next->weight = edge->weight;
+
+        *link = next;
+        link = &next->next;
+        next++;
+      }
+      *link = NULL;
+    }
+  }
+
+  return true;
+}
+
+/***************************************************************************/
+unsigned graph_place_ranges(const graph_t *placed, unsigned bounds[],
+                            unsigned nodes[])
+{
+  assert(placed != NULL);
+  assert(bounds != NULL);
+  assert(nodes != NULL);
+
+  const place_header_t *header = place_header(placed);
+
+  memcpy(bounds, header->bounds, (header->parts + 1) * sizeof(unsigned));
+  memcpy(nodes, header->nodes, header->parts * sizeof(unsigned));
+
+  return header->parts;
+}
+
+/***************************************************************************/
+void graph_place_release(graph_t *placed)
+{
+  assert(placed != NULL);
+
+  if (placed->adjacency_lists != NULL)
+  {
+    place_header_t header = *place_header(placed);
+
+    graph_alloc_free_pages(placed->adjacency_lists, header.size,
+                           &header.policy);
+  }
+
+  placed->vertex_count = 0;
+  placed->edge_count = 0;
+  placed->adjacency_lists = NULL;
+  placed->vertex_capacity = 0;
+}
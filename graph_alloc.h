@@ -0,0 +1,146 @@
+#ifndef GRAPH_ALLOC_H
+#define GRAPH_ALLOC_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "graph.h"
+
+/* Page sizes that can back an allocation. */
+typedef enum graph_pages_e
+{
+  GRAPH_PAGES_DEFAULT,     /* Regular pages. */
+  GRAPH_PAGES_TRANSPARENT, /* Regular pages, advised to be transparent huge
+                            * pages (madvise MADV_HUGEPAGE). */
+  GRAPH_PAGES_EXPLICIT     /* Huge pages from the hugetlb pool (MAP_HUGETLB),
+                            * as GRAPH_PAGES_TRANSPARENT when the pool is
+                            * empty. */
+} graph_pages_t;
+
+/* Placements of an allocation across NUMA nodes. */
+typedef enum graph_placement_e
+{
+  GRAPH_PLACE_FIRST_TOUCH, /* On the node of the thread that touches a page
+                            * first, the default of the operating system. */
+  GRAPH_PLACE_INTERLEAVE,  /* Pages spread round-robin over all nodes. */
+  GRAPH_PLACE_PARTITION    /* Consecutive vertex ranges on consecutive
+                            * nodes (see graph_place). */
+} graph_placement_t;
+
+/* Type representing an allocation policy. */
+typedef struct graph_alloc_policy_s
+{
+  graph_pages_t pages;
+  graph_placement_t placement;
+} graph_alloc_policy_t;
+
+/* graph_alloc_node_count()
+ *
+ * Returns the number of NUMA nodes of this machine, which is 1 when the
+ * machine is not a NUMA system or the number cannot be determined.
+ */
+unsigned graph_alloc_node_count(void);
+
+/* graph_alloc_pages()
+ *
+ * Allocates 'size' bytes of zeroed memory directly from the operating system
+ * with the page size of the given policy. GRAPH_PLACE_INTERLEAVE is applied
+ * to the whole allocation, GRAPH_PLACE_PARTITION is applied with
+ * graph_alloc_bind.
+ *
+ * Policies that cannot be honoured (no huge pages available, no NUMA support)
+ * silently fall back to the default, so the same code runs on every machine.
+ *
+ * Returns NULL when the allocation fails. 
+ *
+ * PRECONDITIONS:
+ *   policy != NULL
+ *   size > 0
+ */
+void *graph_alloc_pages(size_t size, const graph_alloc_policy_t *policy);
+
+/* graph_alloc_bind()
+ *
+ * Asks for the pages that overlap the 'size' bytes at 'address' to be placed
+ * on the given node. The pages are huge pages when the policy asks for them,
+ * so ranges that are bound to different nodes must be split at huge page
+ * boundaries then. Only pages that have not been touched yet are affected.
+ * Does nothing on machines with a single node.
+ *
+ * PRECONDITIONS:
+ *   address points into memory allocated by graph_alloc_pages
+ *   policy != NULL and is the policy of that allocation
+ */
+void graph_alloc_bind(void *address, size_t size, unsigned node,
+                      const graph_alloc_policy_t *policy);
+
+/* graph_alloc_free_pages()
+ *
+ * Releases memory that was allocated by graph_alloc_pages. 'size' and
+ * 'policy' must be the same as those that were passed to graph_alloc_pages.
+ *
+ * PRECONDITIONS:
+ *   policy != NULL
+ */
+void graph_alloc_free_pages(void *address, size_t size,
+                            const graph_alloc_policy_t *policy);
+
+/* graph_place()
+ *
+ * Initialises 'placed' as a copy of the given graph whose adjacency lists and
+ * edges are all stored in one allocation that follows the given policy. The
+ * edges of every vertex are stored consecutively, in vertex order.
+ *
+ * With GRAPH_PLACE_PARTITION the vertices are split into one consecutive
+ * range per NUMA node, with roughly the same number of edges per range, and
+ * the adjacency lists and edges of range i are placed on node i. Threads that
+ * traverse a range should run on its node (see graph_place_ranges). The
+ * ranges are split at page boundaries, huge page boundaries when the policy
+ * asks for huge pages, so a small graph may leave some nodes without
+ * vertices.
+ *
+ * The copy is meant for traversals: it must not be passed to graph_connect,
+ * graph_disconnect, graph_add_vertices, graph_remove_vertex,
+ * graph_canonicalize or graph_release. Use graph_place_release to release it.
+ *
+ * Returns false when the dynamic memory allocation fails. Returns true
+ * otherwise.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ *   placed != NULL
+ *   policy != NULL
+ */
+bool graph_place(const graph_t *graph, graph_t *placed,
+                 const graph_alloc_policy_t *policy);
+
+/* graph_place_ranges()
+ *
+ * Stores the vertex ranges of a graph that was initialised by graph_place
+ * in 'bounds' and 'nodes' and returns their number: range i is bounds[i] ..
+ * bounds[i + 1] - 1 and is placed on node nodes[i]. Nodes that received no
+ * vertices have no range, so there may be fewer ranges than nodes and only
+ * a graph without vertices has an empty range. A graph that was not placed
+ * with GRAPH_PLACE_PARTITION has one range with all vertices on node 0.
+ *
+ * PRECONDITIONS:
+ *   placed != NULL
+ *   placed was initialised by graph_place
+ *   bounds points to memory for graph_alloc_node_count() + 1 values
+ *   nodes points to memory for graph_alloc_node_count() values
+ */
+unsigned graph_place_ranges(const graph_t *placed, unsigned bounds[],
+                            unsigned nodes[]);
+
+/* graph_place_release()
+ *
+ * Releases the memory of a graph that was initialised by graph_place and
+ * updates its member fields to represent an empty graph.
+ *
+ * PRECONDITIONS:
+ *   placed != NULL
+ *   placed was initialised by graph_place
+ */
+void graph_place_release(graph_t *placed);
+
+#endif /* GRAPH_ALLOC_H */
@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "graph_bfs.h"
+
+/* bfs_batch()
+ *
+ * Traverses the graph from the given sources, of which there are at most
+ * GRAPH_BFS_BATCH_SIZE, at once. Bit i of the masks of a vertex refers to
+ * sources[i]. The arrays 'seen', 'frontier' and 'next' must hold one mask
+ * per vertex and be zero.
+ */
+static void
+bfs_batch(const graph_t *graph, const unsigned *sources, unsigned count,
+          unsigned *distances, uint64_t *seen, uint64_t *frontier,
+          uint64_t *next)
+{
+  unsigned vertex_count = graph->vertex_count;
+
+  for (unsigned i = 0; i < count; i++)
+  {
+    unsigned *row = &distances[(size_t) i * vertex_count];
+
+    for (size_t v = 0; v < vertex_count; v++)
+    {
+      row[v] = GRAPH_BFS_UNREACHABLE;
+    }
+
+    if (graph_vertex_exists(graph, sources[i]))
+    {
+      row[sources[i]] = 0;
+      seen[sources[i]] |= UINT64_C(1) << i;
+      frontier[sources[i]] |= UINT64_C(1) << i;
+    }
+  }
+
+  bool active = true;
+
+  for (unsigned level = 1; active; level++)
+  {
+    /* Expand the frontier of all sources along every edge at once. */
+    for (size_t v = 0; v < vertex_count; v++)
+    {
+      uint64_t mask = frontier[v];
+
+      if (mask != 0)
+      {
+        const adjacency_list_t *list = &graph->adjacency_lists[v];
+
+        for (edge_t *edge = list->first; edge != NULL; edge = edge->next)
+        {
+          next[edge->head] |= mask;
+        }
+      }
+    }
+
+    /* Keep the sources that reach a vertex for the first time. */
+    active = false;
+
+    for (size_t v = 0; v < vertex_count; v++)
+    {
+      uint64_t mask = next[v] & ~seen[v];
+
+      next[v] = 0;
+      frontier[v] = mask;
+
+      if (mask != 0)
+      {
+        seen[v] |= mask;
+        active = true;
+
+        while (mask != 0)
+        {
+          unsigned i = __builtin_ctzll(mask);
+
+          distances[(size_t) i * vertex_count + v] = level;
+          mask &= mask - 1;
+        }
+      }
+    }
+  }
+
+  for (size_t v = 0; v < vertex_count; v++)
+  {
+    seen[v] = 0;
+  }
+}
+
+/***************************************************************************/
+bool graph_bfs_multi(const graph_t *graph, const unsigned *sources,
+                     unsigned source_count, unsigned *distances)
+{
+  assert(graph != NULL);
+  assert(sources != NULL || source_count == 0);
+
+  size_t vertex_count = graph->vertex_count > 0 ? graph->vertex_count : 1;
+
+  uint64_t *seen = calloc(vertex_count, sizeof(uint64_t));
+  uint64_t *frontier = calloc(vertex_count, sizeof(uint64_t));
+  uint64_t *next = calloc(vertex_count, sizeof(uint64_t));
+
+  bool result = seen != NULL && frontier != NULL && next != NULL;
+
+  if (result)
+  {
+    for (unsigned i = 0; i < source_count; i += GRAPH_BFS_BATCH_SIZE)
+    {
+      unsigned count = source_count - i;
+
+      if (count > GRAPH_BFS_BATCH_SIZE)
+      {
+        count = GRAPH_BFS_BATCH_SIZE;
+      }
+
+      bfs_batch(graph, &sources[i], count,
+                &distances[(size_t) i * graph->vertex_count],
+                seen, frontier, next);
+    }
+  }
+
+  free(seen);
+  free(frontier);
+  free(next);
+
+  return result;
+}
@@ -0,0 +1,43 @@
+#ifndef GRAPH_BFS_H
+#define GRAPH_BFS_H
+
+#include <limits.h>
+#include <stdbool.h>
+
+#include "graph.h"
+
+/* Distance of a vertex that cannot be reached from a source. */
+#define GRAPH_BFS_UNREACHABLE UINT_MAX
+
+/* Number of sources that are traversed together by graph_bfs_multi. */
+#define GRAPH_BFS_BATCH_SIZE 64
+
+/* graph_bfs_multi()
+ *
+ * Computes the number of edges on a shortest path (the hop distance) from
+ * each of the 'source_count' vertices in the array 'sources' to every vertex
+ * of the given graph. Edge weights are ignored.
+ *
+ * The distance from sources[i] to vertex v is stored in
+ * distances[i * vertex_count + v], or GRAPH_BFS_UNREACHABLE when there is no
+ * path. A source that does not represent a vertex in the given graph, which
+ * includes a removed vertex (see graph_vertex_exists), reaches no vertex at
+ * all.
+ *
+ * The sources are traversed in batches of GRAPH_BFS_BATCH_SIZE. Every vertex
+ * keeps one bit per source of a batch for its frontier and visited sets, so
+ * each edge is scanned once per level for the whole batch instead of once
+ * per source.
+ *
+ * Returns false when the dynamic memory allocation fails. Returns true
+ * otherwise.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ *   sources != NULL || source_count == 0
+ *   distances points to memory for source_count * vertex_count values
+ */
+bool graph_bfs_multi(const graph_t *graph, const unsigned *sources,
+                     unsigned source_count, unsigned *distances);
+
+#endif /* GRAPH_BFS_H */
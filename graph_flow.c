@@ -0,0 +1,638 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "graph_flow.h"
+
+/* Constants of the work threshold after which heights are recomputed by a
+ * global relabelling: GLOBAL_RELABEL_VERTEX * vertex_count + arc_count / 2.
+ */
+#define GLOBAL_RELABEL_VERTEX 6
+#define RELABEL_WORK          12
+
+/* Marks the end of a bucket list. */
+#define NO_VERTEX UINT_MAX
+
+/* Number of vertices of a breadth-first search level that a relabelling
+ * thread claims at a time.
+ */
+#define RELABEL_CHUNK 256
+
+/* Smallest breadth-first search level that is shared with the relabelling
+ * threads. Narrower levels are searched by the calling thread alone, as
+ * waking the threads would cost more than the level itself.
+ */
+#define RELABEL_PARALLEL_LEVEL (4 * RELABEL_CHUNK)
+
+/* Type representing the breadth-first search of a global relabelling that
+ * is shared by the relabelling threads. The vertices of the current level
+ * are queue[begin] .. queue[end - 1] and the vertices of the next level are
+ * appended from queue[end] on.
+ *
+ * The threads live as long as the solver. They wait at the barrier until
+ * the calling thread shares a level with them, search it together with the
+ * calling thread and wait at the barrier again when it is done.
+ */
+typedef struct relabel_s
+{
+  pthread_barrier_t barrier; /* Counts the started threads and the caller. */
+  pthread_mutex_t start;     /* Held until the barrier is initialised. */
+  bool quit;                 /* Set when the threads have to stop. */
+
+  unsigned level;  /* Height of the vertices of the current level. */
+  size_t begin;
+  size_t end;
+  size_t next;     /* First vertex of the current level not yet claimed. */
+  size_t tail;     /* End of the next level. */
+} relabel_t;
+
+/* Type representing the residual graph and the state of the solver.
+ *
+ * The arcs leaving vertex v are first[v] .. first[v + 1] - 1. Every edge of
+ * the graph gives one forward arc with the capacity of the edge and one
+ * reverse arc without capacity; reverse[a] is the arc paired with arc a.
+ */
+typedef struct flow_s
+{
+  unsigned vertex_count;
+  unsigned source;
+  unsigned sink;
+
+  size_t *first;
+  unsigned *head;
+  size_t *reverse;
+  int64_t *capacity; /* Residual capacity of every arc. */
+
+  unsigned *height;
+  int64_t *excess;
+  size_t *current;   /* Next arc to consider when discharging a vertex. */
+
+  /* Doubly linked list of the vertices at every height below n: bucket[h]
+   * is the first vertex at height h, bucket_next and bucket_prev link the
+   * vertices of a bucket, NO_VERTEX ends a list. No bucket above
+   * max_height holds a vertex.
+   */
+  unsigned *bucket;
+  unsigned *bucket_next;
+  unsigned *bucket_prev;
+  unsigned max_height;
+
+  unsigned *queue;   /* FIFO of active vertices. */
+  bool *queued;
+  size_t queue_first;
+  size_t queue_size;
+
+  size_t work;       /* Work done since the last global relabelling. */
+
+  unsigned thread_count; /* Threads that run a global relabelling. */
+  pthread_t *threads;    /* The thread_count - 1 helper threads. */
+  unsigned started;      /* Number of helper threads that are running. */
+  relabel_t relabel;
+} flow_t;
+
+/***************************************************************************/
+static void flow_release(flow_t *flow)
+{
+  free(flow->first);
+  free(flow->head);
+  free(flow->reverse);
+  free(flow->capacity);
+  free(flow->height);
+  free(flow->excess);
+  free(flow->current);
+  free(flow->bucket);
+  free(flow->bucket_next);
+  free(flow->bucket_prev);
+  free(flow->queue);
+  free(flow->queued);
+  free(flow->threads);
+}
+
+/* flow_build()
+ *
+ * Builds the residual graph of the given graph and allocates the state of
+ * the solver. Self-loops are left out as they never carry flow. Returns false
+ * when the dynamic memory allocation fails.
+ */
+static bool flow_build(flow_t *flow, const graph_t *graph)
+{
+  unsigned n = graph->vertex_count;
+
+  flow->vertex_count = n;
+  flow->first = calloc((size_t) n + 1, sizeof(size_t));
+  flow->height = malloc(n * sizeof(unsigned));
+  flow->excess = calloc(n, sizeof(int64_t));
+  flow->current = malloc(n * sizeof(size_t));
+  flow->bucket = malloc(n * sizeof(unsigned));
+  flow->bucket_next = malloc(n * sizeof(unsigned));
+  flow->bucket_prev = malloc(n * sizeof(unsigned));
+  flow->queue = malloc(n * sizeof(unsigned));
+  flow->queued = calloc(n, sizeof(bool));
+  flow->threads = malloc((flow->thread_count - 1) * sizeof(pthread_t) + 1);
+  flow->head = NULL;
+  flow->reverse = NULL;
+  flow->capacity = NULL;
+
+  if (flow->first == NULL || flow->height == NULL || flow->excess == NULL
+      || flow->current == NULL || flow->bucket == NULL
+      || flow->bucket_next == NULL || flow->bucket_prev == NULL
+      || flow->queue == NULL || flow->queued == NULL
+      || flow->threads == NULL)
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < n; i++)
+  {
+    const adjacency_list_t *list = &graph->adjacency_lists[i];
+
+    for (edge_t *edge = list->first; edge != NULL; edge = edge->next)
+    {
+      if (edge->head < n && edge->head != i)
+      {
+        flow->first[i + 1]++;
+        flow->first[edge->head + 1]++;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < n; i++)
+  {
+    flow->first[i + 1] += flow->first[i];
+  }
+
+  size_t arc_count = flow->first[n] > 0 ? flow->first[n] : 1;
+
+  flow->head = malloc(arc_count * sizeof(unsigned));
+  flow->reverse = malloc(arc_count * sizeof(size_t));
+  flow->capacity = malloc(arc_count * sizeof(int64_t));
+
+  if (flow->head == NULL || flow->reverse == NULL || flow->capacity == NULL)
+  {
+    return false;
+  }
+
+  /* 'current' serves as the insertion position of every vertex here. */
+  for (size_t i = 0; i < n; i++)
+  {
+    flow->current[i] = flow->first[i];
+  }
+
+  for (size_t i = 0; i < n; i++)
+  {
+    const adjacency_list_t *list = &graph->adjacency_lists[i];
+
+    for (edge_t *edge = list->first; edge != NULL; edge = edge->next)
+    {
+      if (edge->head < n && edge->head != i)
+      {
+        size_t forward = flow->current[i]++;
+        size_t backward = flow->current[edge->head]++;
+
+        flow->head[forward] = edge->head;
+        flow->reverse[forward] = backward;
+        flow->capacity[forward] = edge->weight;
+
+        flow->head[backward] = i;
+        flow->reverse[backward] = forward;
+        flow->capacity[backward] = 0;
+      }
+    }
+  }
+
+  return true;
+}
+
+/***************************************************************************/
+static void flow_enqueue(flow_t *flow, unsigned v)
+{
+  size_t last = (flow->queue_first + flow->queue_size) % flow->vertex_count;
+
+  flow->queue[last] = v;
+  flow->queue_size++;
+  flow->queued[v] = true;
+}
+
+/***************************************************************************/
+static unsigned flow_dequeue(flow_t *flow)
+{
+  unsigned v = flow->queue[flow->queue_first];
+
+  flow->queue_first = (flow->queue_first + 1) % flow->vertex_count;
+  flow->queue_size--;
+  flow->queued[v] = false;
+
+  return v;
+}
+
+/***************************************************************************/
+static void flow_bucket_insert(flow_t *flow, unsigned v)
+{
+  unsigned h = flow->height[v];
+  unsigned first = flow->bucket[h];
+
+  flow->bucket_next[v] = first;
+  flow->bucket_prev[v] = NO_VERTEX;
+  if (first != NO_VERTEX)
+  {
+    flow->bucket_prev[first] = v;
+  }
+  flow->bucket[h] = v;
+
+  if (h > flow->max_height)
+  {
+    flow->max_height = h;
+  }
+}
+
+/***************************************************************************/
+static void flow_bucket_remove(flow_t *flow, unsigned v)
+{
+  unsigned next = flow->bucket_next[v];
+  unsigned prev = flow->bucket_prev[v];
+
+  if (prev != NO_VERTEX)
+  {
+    flow->bucket_next[prev] = next;
+  }
+  else
+  {
+    flow->bucket[flow->height[v]] = next;
+  }
+  if (next != NO_VERTEX)
+  {
+    flow->bucket_prev[next] = prev;
+  }
+}
+
+/* relabel_level()
+ *
+ * Searches the current level of a global relabelling. The threads claim
+ * chunks of the level and claim every unvisited vertex they find with an
+ * atomic compare-and-swap of its height, so that it is appended to the next
+ * level exactly once.
+ */
+static void relabel_level(flow_t *flow)
+{
+  relabel_t *relabel = &flow->relabel;
+  unsigned n = flow->vertex_count;
+  size_t i;
+
+  while ((i = __sync_fetch_and_add(&relabel->next, RELABEL_CHUNK))
+         < relabel->end)
+  {
+    size_t end = relabel->end - i > RELABEL_CHUNK
+               ? i + RELABEL_CHUNK : relabel->end;
+
+    for (; i < end; i++)
+    {
+      unsigned w = flow->queue[i];
+
+      for (size_t a = flow->first[w]; a < flow->first[w + 1]; a++)
+      {
+        unsigned v = flow->head[a];
+
+        if (v != flow->source && flow->capacity[flow->reverse[a]] > 0
+            && __atomic_load_n(&flow->height[v], __ATOMIC_RELAXED) == n
+            && __sync_bool_compare_and_swap(&flow->height[v], n,
+                                            relabel->level + 1))
+        {
+          flow->queue[__sync_fetch_and_add(&relabel->tail, 1)] = v;
+        }
+      }
+    }
+  }
+}
+
+/* relabel_worker()
+ *
+ * Runs one relabelling thread: searches every level that the calling
+ * thread shares with it until the solver stops the threads.
+ */
+static void *relabel_worker(void *argument)
+{
+  flow_t *flow = argument;
+  relabel_t *relabel = &flow->relabel;
+
+  (void) pthread_mutex_lock(&relabel->start);
+  (void) pthread_mutex_unlock(&relabel->start);
+
+  for (;;)
+  {
+    (void) pthread_barrier_wait(&relabel->barrier);
+
+    if (relabel->quit)
+    {
+      break;
+    }
+
+    relabel_level(flow);
+    (void) pthread_barrier_wait(&relabel->barrier);
+  }
+
+  return NULL;
+}
+
+/* flow_start_threads()
+ *
+ * Starts the thread_count - 1 relabelling threads, or as many of them as
+ * can be created.
+ */
+static void flow_start_threads(flow_t *flow)
+{
+  relabel_t *relabel = &flow->relabel;
+
+  relabel->quit = false;
+  (void) pthread_mutex_init(&relabel->start, NULL);
+  (void) pthread_mutex_lock(&relabel->start);
+
+  flow->started = 0;
+
+  while (flow->started < flow->thread_count - 1
+         && pthread_create(&flow->threads[flow->started], NULL,
+                           relabel_worker, flow) == 0)
+  {
+    flow->started++;
+  }
+
+  (void) pthread_barrier_init(&relabel->barrier, NULL, flow->started + 1);
+  (void) pthread_mutex_unlock(&relabel->start);
+}
+
+/***************************************************************************/
+static void flow_stop_threads(flow_t *flow)
+{
+  relabel_t *relabel = &flow->relabel;
+
+  relabel->quit = true;
+  (void) pthread_barrier_wait(&relabel->barrier);
+
+  for (unsigned i = 0; i < flow->started; i++)
+  {
+    (void) pthread_join(flow->threads[i], NULL);
+  }
+
+  (void) pthread_barrier_destroy(&relabel->barrier);
+  (void) pthread_mutex_destroy(&relabel->start);
+}
+
+/* flow_global_relabel()
+ *
+ * Sets the height of every vertex to its distance to the sink in the
+ * residual graph, or to vertex_count when it cannot reach the sink, and
+ * rebuilds the buckets and the queue of active vertices.
+ *
+ * Levels of the breadth-first search with at least RELABEL_PARALLEL_LEVEL
+ * vertices are searched by the relabelling threads together with the
+ * calling thread, narrower levels by the calling thread alone.
+ */
+static void flow_global_relabel(flow_t *flow)
+{
+  relabel_t *relabel = &flow->relabel;
+  unsigned n = flow->vertex_count;
+
+  for (size_t v = 0; v < n; v++)
+  {
+    flow->height[v] = n;
+    flow->bucket[v] = NO_VERTEX;
+    flow->queued[v] = false;
+  }
+  flow->max_height = 0;
+
+  /* Breadth-first search from the sink along reversed residual arcs, using
+   * the queue for the search itself.
+   */
+  relabel->level = 0;
+  relabel->begin = 0;
+  relabel->end = 1;
+  relabel->next = 0;
+  relabel->tail = 1;
+
+  flow->height[flow->sink] = 0;
+  flow->queue[0] = flow->sink;
+
+  while (relabel->begin < relabel->end)
+  {
+    if (flow->started > 0
+        && relabel->end - relabel->begin >= RELABEL_PARALLEL_LEVEL)
+    {
+      (void) pthread_barrier_wait(&relabel->barrier);
+      relabel_level(flow);
+      (void) pthread_barrier_wait(&relabel->barrier);
+    }
+    else
+    {
+      relabel_level(flow);
+    }
+
+    relabel->begin = relabel->end;
+    relabel->end = relabel->tail;
+    relabel->next = relabel->begin;
+    relabel->level++;
+  }
+
+  /* The queue holds the reached vertices by increasing height. */
+  for (size_t i = 0; i < relabel->end; i++)
+  {
+    flow_bucket_insert(flow, flow->queue[i]);
+  }
+
+  flow->queue_first = 0;
+  flow->queue_size = 0;
+
+  for (size_t v = 0; v < n; v++)
+  {
+    flow->current[v] = flow->first[v];
+
+    if (flow->excess[v] > 0 && flow->height[v] < n && v != flow->sink)
+    {
+      flow_enqueue(flow, v);
+    }
+  }
+
+  flow->work = 0;
+}
+
+/* flow_relabel()
+ *
+ * Lifts vertex v to one above its lowest residual neighbour. When v was the
+ * last vertex at its height, no vertex above that height can reach the sink
+ * any more and they are all lifted to vertex_count at once (gap heuristic).
+ * The buckets above the gap hold exactly these vertices, so the gap costs
+ * time proportional to their number rather than to vertex_count.
+ */
+static void flow_relabel(flow_t *flow, unsigned v)
+{
+  unsigned n = flow->vertex_count;
+  unsigned old = flow->height[v];
+  unsigned lowest = n;
+
+  for (size_t a = flow->first[v]; a < flow->first[v + 1]; a++)
+  {
+    if (flow->capacity[a] > 0 && flow->height[flow->head[a]] < lowest)
+    {
+      lowest = flow->height[flow->head[a]];
+    }
+  }
+
+  flow->work += RELABEL_WORK + flow->first[v + 1] - flow->first[v];
+  flow_bucket_remove(flow, v);
+
+  if (flow->bucket[old] == NO_VERTEX)
+  {
+    for (unsigned h = old + 1; h <= flow->max_height; h++)
+    {
+      for (unsigned u = flow->bucket[h]; u != NO_VERTEX;
+           u = flow->bucket_next[u])
+      {
+        flow->height[u] = n;
+      }
+      flow->bucket[h] = NO_VERTEX;
+    }
+    flow->max_height = old;
+    flow->height[v] = n;
+  }
+  else
+  {
+    flow->height[v] = lowest < n - 1 ? lowest + 1 : n;
+
+    if (flow->height[v] < n)
+    {
+      flow_bucket_insert(flow, v);
+    }
+  }
+
+  flow->current[v] = flow->first[v];
+}
+
+/* flow_discharge()
+ *
+ * Pushes the excess of vertex v to lower neighbours, relabelling v whenever
+ * it has no admissible arc left, until v has no excess or cannot reach the
+ * sink any more.
+ */
+static void flow_discharge(flow_t *flow, unsigned v)
+{
+  unsigned n = flow->vertex_count;
+
+  while (flow->excess[v] > 0 && flow->height[v] < n)
+  {
+    size_t a = flow->current[v];
+
+    if (a == flow->first[v + 1])
+    {
+      flow_relabel(flow, v);
+      continue;
+    }
+
+    unsigned w = flow->head[a];
+
+    if (flow->capacity[a] > 0 && flow->height[v] == flow->height[w] + 1)
+    {
+      int64_t delta = flow->excess[v] < flow->capacity[a]
+                    ? flow->excess[v] : flow->capacity[a];
+
+      flow->capacity[a] -= delta;
+      flow->capacity[flow->reverse[a]] += delta;
+      flow->excess[v] -= delta;
+      flow->excess[w] += delta;
+
+      if (! flow->queued[w] && w != flow->sink && w != flow->source)
+      {
+        flow_enqueue(flow, w);
+      }
+    }
+    else
+    {
+      flow->current[v]++;
+    }
+  }
+}
+
+/***************************************************************************/
+bool graph_max_flow(const graph_t *graph, unsigned source, unsigned sink,
+                    uint64_t *flow, bool *source_side)
+{
+  return graph_max_flow_parallel(graph, source, sink, flow, source_side, 1);
+}
+
+/***************************************************************************/
+bool graph_max_flow_parallel(const graph_t *graph, unsigned source,
+                             unsigned sink, uint64_t *flow, bool *source_side,
+                             unsigned thread_count)
+{
+  assert(graph != NULL);
+  assert(flow != NULL);
+
+  unsigned n = graph->vertex_count;
+
+  if (source >= n || sink >= n || source == sink)
+  {
+    return false;
+  }
+
+  if (thread_count == 0)
+  {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    thread_count = processors > 0 ? (unsigned) processors : 1;
+  }
+
+  flow_t state;
+  state.source = source;
+  state.sink = sink;
+  state.thread_count = thread_count;
+
+  bool result = flow_build(&state, graph);
+
+  if (result)
+  {
+    flow_start_threads(&state);
+
+    /* Saturate every arc leaving the source. */
+    for (size_t a = state.first[source]; a < state.first[source + 1]; a++)
+    {
+      int64_t delta = state.capacity[a];
+
+      state.capacity[a] = 0;
+      state.capacity[state.reverse[a]] += delta;
+      state.excess[state.head[a]] += delta;
+    }
+
+    flow_global_relabel(&state);
+
+    size_t threshold = (size_t) GLOBAL_RELABEL_VERTEX * n
+                     + state.first[n] / 2;
+
+    while (state.queue_size > 0)
+    {
+      flow_discharge(&state, flow_dequeue(&state));
+
+      if (state.work > threshold)
+      {
+        flow_global_relabel(&state);
+      }
+    }
+
+    *flow = state.excess[sink];
+
+    /* The vertices that can still reach the sink form the sink side. */
+    if (source_side != NULL)
+    {
+      flow_global_relabel(&state);
+
+      for (size_t v = 0; v < n; v++)
+      {
+        source_side[v] = state.height[v] == n;
+      }
+    }
+
+    flow_stop_threads(&state);
+  }
+
+  flow_release(&state);
+
+  return result;
+}
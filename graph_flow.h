@@ -0,0 +1,57 @@
+#ifndef GRAPH_FLOW_H
+#define GRAPH_FLOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "graph.h"
+
+/* graph_max_flow()
+ *
+ * Computes a maximum flow from the vertex 'source' to the vertex 'sink' in
+ * the given graph, interpreting the weight of every edge as its capacity,
+ * and stores its value in the variable pointed to by 'flow'.
+ *
+ * When 'source_side' is not NULL, it receives a minimum cut: 
+ * source_side[v] is true if vertex v is on the source side of the cut and
+ * false otherwise. The total capacity of the edges from the source side to
+ * the other side equals the maximum flow.
+ *
+ * The flow is computed with the push-relabel method on a residual graph that
+ * is built once from the adjacency lists, using FIFO vertex selection and
+ * the global relabelling and gap heuristics.
+ *
+ * Returns false when source or sink does not represent a vertex in the given
+ * graph, when they are the same vertex or when the dynamic memory allocation
+ * fails. Returns true otherwise.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ *   flow != NULL
+ *   source_side == NULL or points to memory for vertex_count values
+ */
+bool graph_max_flow(const graph_t *graph, unsigned source, unsigned sink,
+                    uint64_t *flow, bool *source_side);
+
+/* graph_max_flow_parallel()
+ *
+ * Computes the same maximum flow and minimum cut as graph_max_flow, but runs
+ * the breadth-first search of every global relabelling with thread_count
+ * threads in parallel, or with one thread per online processor when
+ * thread_count is 0. The threads are created once per call and process one
+ * distance level at a time, claiming the vertices of the next level with
+ * atomic operations. Levels too narrow to be worth sharing, and the pushes
+ * and local relabels, are done by the calling thread alone. When threads
+ * cannot be created, the calling thread does the remaining work.
+ *
+ * The flow value and the cut do not depend on the number of threads,
+ * although the flow may be routed differently.
+ *
+ * PRECONDITIONS:
+ *   see graph_max_flow
+ */
+bool graph_max_flow_parallel(const graph_t *graph, unsigned source,
+                             unsigned sink, uint64_t *flow, bool *source_side,
+                             unsigned thread_count);
+
+#endif /* GRAPH_FLOW_H */
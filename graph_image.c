@@ -0,0 +1,370 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "graph_image.h"
+
+#define IMAGE_MAGIC   0x474d4947u /* "GIMG" */
+#define IMAGE_VERSION 1u
+
+/* Type representing the header at the start of every image. All offsets are
+ * in bytes, relative to the start of the image.
+ */
+typedef struct image_header_s
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t generation;
+  uint64_t size;
+
+  uint32_t vertex_count;
+  uint32_t edge_count;
+
+  uint64_t offsets;
+  uint64_t heads;
+  uint64_t weights;
+  uint64_t indegrees;
+} image_header_t;
+
+/* Type representing an edge while the image is being built. */
+typedef struct image_edge_s
+{
+  uint32_t head;
+  uint32_t weight;
+} image_edge_t;
+
+/***************************************************************************/
+static int compare_edges(const void *a, const void *b)
+{
+  const image_edge_t *x = a;
+  const image_edge_t *y = b;
+
+  if (x->head != y->head)
+  {
+    return x->head < y->head ? -1 : 1;
+  }
+
+  return x->weight < y->weight ? -1 : (x->weight > y->weight);
+}
+
+/* fill_image()
+ *
+ * Stores the image of the given graph in the memory region pointed to by
+ * 'base', which is laid out according to the given header. 'buffer' must
+ * point to memory for as many edges as the largest outdegree.
+ */
+static void
+fill_image(const graph_t *graph, void *base, const image_header_t *header,
+           image_edge_t *buffer)
+{
+  char *bytes = base;
+
+  uint32_t *offsets = (uint32_t *) (bytes + header->offsets);
+  uint32_t *heads = (uint32_t *) (bytes + header->heads);
+  uint32_t *weights = (uint32_t *) (bytes + header->weights);
+  uint32_t *indegrees = (uint32_t *) (bytes + header->indegrees);
+
+  memset(indegrees, 0, header->vertex_count * sizeof(uint32_t));
+
+  uint32_t offset = 0;
+
+  for (size_t i = 0; i < header->vertex_count; i++)
+  {
+    const adjacency_list_t *list = &graph->adjacency_lists[i];
+    uint32_t count = 0;
+
+    for (edge_t *edge = list->first; edge != NULL; edge = edge->next)
+    {
+      buffer[count].head = edge->head;
+      buffer[count].weight = edge->weight;
+      count++;
+
+      if (edge->head < header->vertex_count)
+      {
+        indegrees[edge->head]++;
+      }
+    }
+
+    qsort(buffer, count, sizeof(image_edge_t), compare_edges);
+
+    offsets[i] = offset;
+    for (uint32_t j = 0; j < count; j++)
+    {
+      heads[offset + j] = buffer[j].head;
+      weights[offset + j] = buffer[j].weight;
+    }
+    offset += count;
+  }
+  offsets[header->vertex_count] = offset;
+
+  memcpy(base, header, sizeof(image_header_t));
+}
+
+/***************************************************************************/
+bool graph_image_publish(const graph_t *graph, const char *pathname)
+{
+  assert(graph != NULL);
+  assert(pathname != NULL);
+
+  image_header_t header;
+  memset(&header, 0, sizeof(header));
+
+  header.magic = IMAGE_MAGIC;
+  header.version = IMAGE_VERSION;
+  header.generation = 1;
+  header.vertex_count = graph->vertex_count;
+
+  size_t max_outdegree = 0;
+
+  for (size_t i = 0; i < graph->vertex_count; i++)
+  {
+    const adjacency_list_t *list = &graph->adjacency_lists[i];
+    size_t outdegree = 0;
+
+    for (edge_t *edge = list->first; edge != NULL; edge = edge->next)
+    {
+      outdegree++;
+    }
+
+    header.edge_count += outdegree;
+    if (outdegree > max_outdegree)
+    {
+      max_outdegree = outdegree;
+    }
+  }
+
+  header.offsets = sizeof(image_header_t);
+  header.heads = header.offsets
+               + ((uint64_t) header.vertex_count + 1) * sizeof(uint32_t);
+  header.weights = header.heads
+                 + (uint64_t) header.edge_count * sizeof(uint32_t);
+  header.indegrees = header.weights
+                   + (uint64_t) header.edge_count * sizeof(uint32_t);
+  header.size = header.indegrees
+              + (uint64_t) header.vertex_count * sizeof(uint32_t);
+
+  graph_image_t previous;
+
+  if (graph_image_attach(&previous, pathname))
+  {
+    header.generation = previous.generation + 1;
+    graph_image_detach(&previous);
+  }
+
+  size_t length = strlen(pathname) + 32;
+  char *temporary = malloc(length);
+  image_edge_t *buffer = malloc((max_outdegree + 1) * sizeof(image_edge_t));
+
+  bool result = false;
+
+  if (temporary != NULL && buffer != NULL)
+  {
+    snprintf(temporary, length, "%s.%ld.tmp", pathname, (long) getpid());
+
+    int fd = open(temporary, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd >= 0)
+    {
+      if (ftruncate(fd, header.size) == 0)
+      {
+        void *base = mmap(NULL, header.size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd, 0);
+
+        if (base != MAP_FAILED)
+        {
+          fill_image(graph, base, &header, buffer);
+          result = munmap(base, header.size) == 0;
+        }
+      }
+
+      result = close(fd) == 0 && result;
+
+      /* Readers only ever see a complete image. */
+      result = result && rename(temporary, pathname) == 0;
+
+      if (! result)
+      {
+        (void) unlink(temporary);
+      }
+    }
+  }
+
+  free(temporary);
+  free(buffer);
+
+  return result;
+}
+
+/***************************************************************************/
+bool graph_image_attach(graph_image_t *image, const char *pathname)
+{
+  assert(image != NULL);
+  assert(pathname != NULL);
+
+  int fd = open(pathname, O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat st;
+  void *base = MAP_FAILED;
+
+  if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(image_header_t))
+  {
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  (void) close(fd);
+
+  if (base == MAP_FAILED)
+  {
+    return false;
+  }
+
+  const image_header_t *header = base;
+  const uint64_t vertex_count = header->vertex_count;
+  const uint64_t edge_count = header->edge_count;
+
+  bool valid = header->magic == IMAGE_MAGIC
+            && header->version == IMAGE_VERSION
+            && header->size == (uint64_t) st.st_size
+            && header->offsets == sizeof(image_header_t)
+            && header->heads == header->offsets + (vertex_count + 1) * 4
+            && header->weights == header->heads + edge_count * 4
+            && header->indegrees == header->weights + edge_count * 4
+            && header->size == header->indegrees + vertex_count * 4;
+
+  if (! valid)
+  {
+    (void) munmap(base, st.st_size);
+
+    return false;
+  }
+
+  const char *bytes = base;
+
+  image->base = base;
+  image->size = st.st_size;
+  image->generation = header->generation;
+  image->vertex_count = header->vertex_count;
+  image->edge_count = header->edge_count;
+  image->offsets = (const uint32_t *) (bytes + header->offsets);
+  image->heads = (const uint32_t *) (bytes + header->heads);
+  image->weights = (const uint32_t *) (bytes + header->weights);
+  image->indegrees = (const uint32_t *) (bytes + header->indegrees);
+  image->device = st.st_dev;
+  image->inode = st.st_ino;
+
+  return true;
+}
+
+/***************************************************************************/
+void graph_image_detach(graph_image_t *image)
+{
+  assert(image != NULL);
+
+  if (image->base != NULL)
+  {
+    (void) munmap((void *) image->base, image->size);
+  }
+
+  memset(image, 0, sizeof(*image));
+}
+
+/***************************************************************************/
+bool graph_image_is_current(const graph_image_t *image, const char *pathname)
+{
+  assert(image != NULL);
+  assert(pathname != NULL);
+
+  struct stat st;
+
+  return stat(pathname, &st) == 0
+      && st.st_dev == image->device
+      && st.st_ino == image->inode;
+}
+
+/***************************************************************************/
+unsigned graph_image_outdegree(const graph_image_t *image, unsigned id)
+{
+  assert(image != NULL);
+
+  if (id >= image->vertex_count)
+  {
+    return 0;
+  }
+
+  return image->offsets[id + 1] - image->offsets[id];
+}
+
+/***************************************************************************/
+unsigned graph_image_indegree(const graph_image_t *image, unsigned id)
+{
+  assert(image != NULL);
+
+  if (id >= image->vertex_count)
+  {
+    return 0;
+  }
+
+  return image->indegrees[id];
+}
+
+/***************************************************************************/
+bool graph_image_contains(const graph_image_t *image, unsigned tail,
+                          unsigned head)
+{
+  assert(image != NULL);
+
+  if (tail >= image->vertex_count)
+  {
+    return false;
+  }
+
+  uint32_t low = image->offsets[tail];
+  uint32_t high = image->offsets[tail + 1];
+
+  while (low < high)
+  {
+    uint32_t middle = low + (high - low) / 2;
+
+    if (image->heads[middle] < head)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  return low < image->offsets[tail + 1] && image->heads[low] == head;
+}
+
+/***************************************************************************/
+unsigned graph_image_neighbours(const graph_image_t *image, unsigned id,
+                                const uint32_t **heads,
+                                const uint32_t **weights)
+{
+  assert(image != NULL);
+  assert(heads != NULL);
+  assert(weights != NULL);
+
+  if (id >= image->vertex_count)
+  {
+    *heads = NULL;
+    *weights = NULL;
+
+    return 0;
+  }
+
+  *heads = &image->heads[image->offsets[id]];
+  *weights = &image->weights[image->offsets[id]];
+
+  return image->offsets[id + 1] - image->offsets[id];
+}
@@ -0,0 +1,145 @@
+#ifndef GRAPH_IMAGE_H
+#define GRAPH_IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "graph.h"
+
+/* Type representing a read-only graph image that is mapped into memory.
+ *
+ * An image stores a graph in a compact, position-independent layout: all
+ * references inside the image are offsets instead of pointers, so every
+ * process can map it at a different address. The heads of the outgoing
+ * edges of vertex v are heads[offsets[v]] .. heads[offsets[v + 1] - 1],
+ * sorted in ascending order, with the matching weights at the same
+ * positions in the weights array.
+ */
+typedef struct graph_image_s
+{
+  const void *base;  /* Start of the mapping. */
+  size_t size;       /* Size of the mapping in bytes. */
+
+  uint64_t generation;   /* Incremented by every graph_image_publish. */
+  unsigned vertex_count; /* Number of vertices in this graph. */
+  unsigned edge_count;   /* Number of edges in this graph. */
+
+  const uint32_t *offsets;   /* vertex_count + 1 edge offsets. */
+  const uint32_t *heads;     /* edge_count heads. */
+  const uint32_t *weights;   /* edge_count weights. */
+  const uint32_t *indegrees; /* vertex_count indegrees. */
+
+  dev_t device; /* Identifies the file that is mapped. */
+  ino_t inode;
+} graph_image_t;
+
+/* graph_image_publish()
+ *
+ * Writes an image of the given graph to the file whose name is the string
+ * pointed to by pathname. Use a path in /dev/shm to keep the image in shared
+ * memory instead of on disk.
+ *
+ * The image is written to a temporary file that atomically replaces the
+ * previous image, if any, when it is complete. Processes that have the
+ * previous image attached keep using it until they attach the new one, so
+ * a graph can be reloaded without interrupting its readers. The generation
+ * of the new image is one more than that of the image it replaces.
+ *
+ * Returns false when creating, mapping or renaming the file fails. Returns
+ * true otherwise.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ *   pathname != NULL
+ */
+bool graph_image_publish(const graph_t *graph, const char *pathname);
+
+/* graph_image_attach()
+ *
+ * Maps the image in the file whose name is the string pointed to by
+ * pathname read-only into memory and initialises 'image' to refer to it.
+ * This takes constant time: nothing is copied or rebuilt.
+ *
+ * Returns false when the file cannot be mapped or does not contain a valid
+ * image. Returns true otherwise.
+ *
+ * PRECONDITIONS:
+ *   image != NULL
+ *   pathname != NULL
+ */
+bool graph_image_attach(graph_image_t *image, const char *pathname);
+
+/* graph_image_detach()
+ *
+ * Unmaps the given image. 
+ *
+ * PRECONDITIONS:
+ *   image != NULL
+ *   image was attached with graph_image_attach
+ */
+void graph_image_detach(graph_image_t *image);
+
+/* graph_image_is_current()
+ *
+ * Returns true if the given image is still the one that is published under
+ * the given pathname, false if it has been replaced or removed since it was
+ * attached.
+ *
+ * PRECONDITIONS:
+ *   image != NULL
+ *   pathname != NULL
+ */
+bool graph_image_is_current(const graph_image_t *image, const char *pathname);
+
+/* graph_image_outdegree()
+ *
+ * Returns the outdegree of the vertex with the given identifier in the given
+ * image, or 0 if the given id does not represent a vertex in the image.
+ * 
+ * PRECONDITIONS:
+ *   image != NULL
+ */
+unsigned graph_image_outdegree(const graph_image_t *image, unsigned id);
+
+/* graph_image_indegree()
+ *
+ * Returns the indegree of the vertex with the given identifier in the given
+ * image, or 0 if the given id does not represent a vertex in the image.
+ * 
+ * PRECONDITIONS:
+ *   image != NULL
+ */
+unsigned graph_image_indegree(const graph_image_t *image, unsigned id);
+
+/* graph_image_contains()
+ *
+ * Returns true if the given image contains an edge with the given tail and
+ * the given head, false otherwise. Takes logarithmic time in the outdegree
+ * of the tail.
+ * 
+ * PRECONDITIONS:
+ *   image != NULL
+ */
+bool graph_image_contains(const graph_image_t *image, unsigned tail,
+                          unsigned head);
+
+/* graph_image_neighbours()
+ *
+ * Stores pointers to the heads and the weights of the outgoing edges of the
+ * vertex with the given identifier in the variables pointed to by 'heads' and
+ * 'weights' and returns the number of those edges. The heads are sorted in
+ * ascending order. Returns 0 if the given id does not represent a vertex in
+ * the image.
+ *
+ * PRECONDITIONS:
+ *   image != NULL
+ *   heads != NULL
+ *   weights != NULL
+ */
+unsigned graph_image_neighbours(const graph_image_t *image, unsigned id,
+                                const uint32_t **heads,
+                                const uint32_t **weights);
+
+#endif /* GRAPH_IMAGE_H */
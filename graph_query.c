@@ -0,0 +1,290 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <assert.h>
+
+#include "graph_query.h"
+
+/* Marks an unused slot of the hash set, no vertex has this identifier. */
+#define EMPTY UINT_MAX
+
+/***************************************************************************/
+static unsigned hash(const graph_query_t *query, unsigned vertex)
+{
+  /* Fibonacci hashing, folding the high bits into the masked low bits */
+  unsigned h = vertex * 2654435769u;
+
+  return (h ^ (h >> 16)) & query->table_mask;
+}
+
+/* query_clear()
+ *
+ * Empties the result of the given workspace, clearing only the slots of the
+ * hash set that are in use.
+ */
+static void query_clear(graph_query_t *query)
+{
+  for (unsigned i = 0; i < query->vertex_count; i++)
+  {
+    query->table_keys[query->slots[i]] = EMPTY;
+  }
+
+  query->vertex_count = 0;
+  query->edge_count = 0;
+  query->offsets[0] = 0;
+  query->truncated = false;
+}
+
+/* query_find()
+ *
+ * Returns the local identifier of the given vertex, or EMPTY when it is not
+ * part of the result.
+ */
+static unsigned query_find(const graph_query_t *query, unsigned vertex)
+{
+  unsigned slot = hash(query, vertex);
+
+  while (query->table_keys[slot] != EMPTY)
+  {
+    if (query->table_keys[slot] == vertex)
+    {
+      return query->table_values[slot];
+    }
+    slot = (slot + 1) & query->table_mask;
+  }
+
+  return EMPTY;
+}
+
+/* query_add()
+ *
+ * Adds the given vertex to the result unless it is already part of it.
+ * Returns true when the vertex was added.
+ *
+ * PRECONDITIONS:
+ *   vertex_count < max_vertices
+ */
+static bool query_add(graph_query_t *query, unsigned vertex, unsigned depth)
+{
+  unsigned slot = hash(query, vertex);
+
+  while (query->table_keys[slot] != EMPTY)
+  {
+    if (query->table_keys[slot] == vertex)
+    {
+      return false;
+    }
+    slot = (slot + 1) & query->table_mask;
+  }
+
+  unsigned local = query->vertex_count++;
+
+  query->table_keys[slot] = vertex;
+  query->table_values[slot] = local;
+  query->slots[local] = slot;
+  query->vertices[local] = vertex;
+  query->depths[local] = depth;
+
+  return true;
+}
+
+/***************************************************************************/
+bool graph_query_initialise(graph_query_t *query, unsigned max_vertices,
+                            size_t max_edges)
+{
+  assert(query != NULL);
+  assert(max_vertices > 0);
+
+  /* Keep the hash set at most half full. */
+  size_t table_size = 2;
+
+  while (table_size < 2 * (size_t) max_vertices)
+  {
+    table_size *= 2;
+  }
+
+  memset(query, 0, sizeof(*query));
+
+  if (table_size - 1 > UINT_MAX)
+  {
+    return false;
+  }
+
+  query->max_vertices = max_vertices;
+  query->max_edges = max_edges;
+  query->table_mask = table_size - 1;
+
+  query->vertices = malloc(max_vertices * sizeof(unsigned));
+  query->depths = malloc(max_vertices * sizeof(unsigned));
+  query->offsets = malloc(((size_t) max_vertices + 1) * sizeof(size_t));
+  query->heads = malloc((max_edges > 0 ? max_edges : 1) * sizeof(unsigned));
+  query->weights = malloc((max_edges > 0 ? max_edges : 1) * sizeof(unsigned));
+  query->table_keys = malloc(table_size * sizeof(unsigned));
+  query->table_values = malloc(table_size * sizeof(unsigned));
+  query->slots = malloc(max_vertices * sizeof(unsigned));
+
+  if (query->vertices == NULL || query->depths == NULL
+      || query->offsets == NULL || query->heads == NULL
+      || query->weights == NULL || query->table_keys == NULL
+      || query->table_values == NULL || query->slots == NULL)
+  {
+    graph_query_release(query);
+
+    return false;
+  }
+
+  for (size_t i = 0; i < table_size; i++)
+  {
+    query->table_keys[i] = EMPTY;
+  }
+  query->offsets[0] = 0;
+
+  return true;
+}
+
+/***************************************************************************/
+void graph_query_release(graph_query_t *query)
+{
+  assert(query != NULL);
+
+  free(query->vertices);
+  free(query->depths);
+  free(query->offsets);
+  free(query->heads);
+  free(query->weights);
+  free(query->table_keys);
+  free(query->table_values);
+  free(query->slots);
+
+  memset(query, 0, sizeof(*query));
+}
+
+/***************************************************************************/
+unsigned graph_khop(graph_query_t *query, const graph_t *graph,
+                    unsigned source, unsigned k, unsigned fanout)
+{
+  assert(query != NULL);
+  assert(graph != NULL);
+
+  query_clear(query);
+
+  if (! graph_vertex_exists(graph, source))
+  {
+    return 0;
+  }
+
+  (void) query_add(query, source, 0);
+
+  /* The result doubles as the queue of the breadth-first search. */
+  for (unsigned next = 0; next < query->vertex_count; next++)
+  {
+    unsigned depth = query->depths[next];
+
+    if (depth == k)
+    {
+      break; /* All remaining vertices are at depth k as well */
+    }
+
+    unsigned vertex = query->vertices[next];
+    const adjacency_list_t *list = &graph->adjacency_lists[vertex];
+    unsigned followed = 0;
+
+    for (edge_t *edge = list->first; edge != NULL; edge = edge->next)
+    {
+      if (fanout > 0 && followed == fanout)
+      {
+        query->truncated = true;
+        break;
+      }
+      followed++;
+
+      if (query_find(query, edge->head) == EMPTY)
+      {
+        if (query->vertex_count == query->max_vertices)
+        {
+          query->truncated = true;
+
+          return query->vertex_count;
+        }
+
+        (void) query_add(query, edge->head, depth + 1);
+      }
+    }
+  }
+
+  return query->vertex_count;
+}
+
+/***************************************************************************/
+unsigned graph_query_set_vertices(graph_query_t *query,
+                                  const unsigned *vertices, unsigned count)
+{
+  assert(query != NULL);
+  assert(vertices != NULL || count == 0);
+
+  query_clear(query);
+
+  for (unsigned i = 0; i < count; i++)
+  {
+    if (query_find(query, vertices[i]) == EMPTY)
+    {
+      if (query->vertex_count == query->max_vertices)
+      {
+        query->truncated = true;
+        break;
+      }
+
+      (void) query_add(query, vertices[i], 0);
+    }
+  }
+
+  return query->vertex_count;
+}
+
+/***************************************************************************/
+bool graph_induced_subgraph(graph_query_t *query, const graph_t *graph,
+                            unsigned fanout)
+{
+  assert(query != NULL);
+  assert(graph != NULL);
+
+  size_t edge_count = 0;
+  bool result = true;
+
+  for (unsigned i = 0; i < query->vertex_count; i++)
+  {
+    unsigned vertex = query->vertices[i];
+    const adjacency_list_t *list = &graph->adjacency_lists[vertex];
+    unsigned followed = 0;
+
+    query->offsets[i] = edge_count;
+
+    for (edge_t *edge = list->first;
+         edge != NULL && (fanout == 0 || followed < fanout);
+         edge = edge->next)
+    {
+      unsigned head = query_find(query, edge->head);
+
+      followed++;
+
+      if (head != EMPTY)
+      {
+        if (edge_count == query->max_edges)
+        {
+          result = false;
+          break;
+        }
+
+        query->heads[edge_count] = head;
+        query->weights[edge_count] = edge->weight;
+        edge_count++;
+      }
+    }
+  }
+
+  query->offsets[query->vertex_count] = edge_count;
+  query->edge_count = edge_count;
+  query->truncated = query->truncated || ! result;
+
+  return result;
+}
@@ -0,0 +1,135 @@
+#ifndef GRAPH_QUERY_H
+#define GRAPH_QUERY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "graph.h"
+
+/* Type representing a reusable workspace for neighbourhood queries.
+ *
+ * All memory is allocated once by graph_query_initialise and its size only
+ * depends on the limits given there, not on the size of the graph. Queries
+ * themselves never allocate memory. The vertices that are found are kept in
+ * a small hash set that is cleared in time proportional to the number of
+ * vertices found by the previous query.
+ *
+ * The result of the last query is available in the member variables below.
+ * Vertex i of the result (its local identifier) is vertices[i] in the graph.
+ */
+typedef struct graph_query_s
+{
+  unsigned max_vertices; /* Maximum number of vertices in a result. */
+  size_t max_edges;      /* Maximum number of edges in a subgraph. */
+
+  unsigned vertex_count; /* Number of vertices in the result. */
+  unsigned *vertices;    /* Identifiers of the vertices in the graph. */
+  unsigned *depths;      /* Hop distances from the source (graph_khop). */
+
+  /* Subgraph induced on the vertices of the result (graph_induced_subgraph):
+   * the local heads of the edges of local vertex i are
+   * heads[offsets[i]] .. heads[offsets[i + 1] - 1] and their weights are
+   * at the same positions in weights.
+   */
+  size_t edge_count;
+  size_t *offsets;
+  unsigned *heads;
+  unsigned *weights;
+
+  /* True when the result was cut short by max_vertices or max_edges. */
+  bool truncated;
+
+  /* Hash set that maps the vertices of the result to local identifiers. */
+  unsigned table_mask;
+  unsigned *table_keys;
+  unsigned *table_values;
+  unsigned *slots; /* Slot in the hash set of every local vertex. */
+} graph_query_t;
+
+/* graph_query_initialise()
+ *
+ * Initialises the given workspace for results of at most max_vertices
+ * vertices and max_edges edges.
+ *
+ * Returns false when the dynamic memory allocation fails. Returns true
+ * otherwise.
+ *
+ * PRECONDITIONS:
+ *   query != NULL
+ *   max_vertices > 0
+ */
+bool graph_query_initialise(graph_query_t *query, unsigned max_vertices,
+                            size_t max_edges);
+
+/* graph_query_release()
+ *
+ * Releases the memory that was allocated by graph_query_initialise.
+ *
+ * PRECONDITIONS:
+ *   query != NULL
+ */
+void graph_query_release(graph_query_t *query);
+
+/* graph_khop()
+ *
+ * Finds all vertices of the given graph that can be reached from the vertex
+ * 'source' in at most k edges and stores them in breadth-first order, with
+ * their distances, in the result of the given workspace. 
+ *
+ * When fanout is not 0, at most fanout outgoing edges of every vertex are
+ * followed, which bounds the cost of expanding hub vertices. The search
+ * stops when max_vertices vertices have been found; truncated is set in
+ * both cases where vertices may have been missed.
+ *
+ * Returns the number of vertices found, which is 0 if source does not
+ * represent a vertex in the given graph or has been removed (see
+ * graph_vertex_exists).
+ *
+ * PRECONDITIONS:
+ *   query != NULL
+ *   graph != NULL
+ *   query is properly initialised
+ */
+unsigned graph_khop(graph_query_t *query, const graph_t *graph,
+                    unsigned source, unsigned k, unsigned fanout);
+
+/* graph_query_set_vertices()
+ *
+ * Replaces the vertices of the result of the given workspace by the given
+ * vertices, skipping duplicates. Their depths are set to 0. 
+ *
+ * Returns the number of vertices stored, which is less than count when there
+ * are duplicates or more than max_vertices vertices.
+ *
+ * PRECONDITIONS:
+ *   query != NULL
+ *   vertices != NULL || count == 0
+ *   query is properly initialised
+ */
+unsigned graph_query_set_vertices(graph_query_t *query,
+                                  const unsigned *vertices, unsigned count);
+
+/* graph_induced_subgraph()
+ *
+ * Stores the subgraph of the given graph that is induced on the vertices of
+ * the result of the given workspace, i.e. all edges between those vertices,
+ * in the offsets, heads and weights of the workspace, using local vertex
+ * identifiers. Usually called after graph_khop or graph_query_set_vertices.
+ *
+ * When fanout is not 0, only the first fanout edges in the adjacency list
+ * of every vertex are considered.
+ *
+ * Returns false when the subgraph has more than max_edges edges, in which
+ * case only the first max_edges edges are stored and truncated is set.
+ * Returns true otherwise.
+ *
+ * PRECONDITIONS:
+ *   query != NULL
+ *   graph != NULL
+ *   query is properly initialised
+ *   the vertices of the result are vertices of the given graph
+ */
+bool graph_induced_subgraph(graph_query_t *query, const graph_t *graph,
+                            unsigned fanout);
+
+#endif /* GRAPH_QUERY_H */
@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+#include "graph_update.h"
+
+/* Maximum length of a line in a text update log. */
+#define UPDATE_LINE_SIZE 128
+
+/* Type representing one update of a batch. */
+typedef struct update_s
+{
+  unsigned tail;
+  unsigned head;
+  unsigned weight;
+  unsigned seq;   /* Position of the update in its batch. */
+  bool connect;   /* true for '+', false for '-'. */
+} update_t;
+
+/* Type representing the state of a stream that is being read. A partially
+ * written line or record is kept in 'pending' until the rest of it arrives.
+ */
+typedef struct update_reader_s
+{
+  FILE *fp;
+  graph_update_format_t format;
+
+  char pending[UPDATE_LINE_SIZE];
+  size_t pending_size;
+  bool overflow;  /* The pending line did not fit in 'pending'. */
+} update_reader_t;
+
+/***************************************************************************/
+static int compare_updates(const void *a, const void *b)
+{
+  const update_t *x = a;
+  const update_t *y = b;
+
+  if (x->tail != y->tail)
+  {
+    return x->tail < y->tail ? -1 : 1;
+  }
+  if (x->head != y->head)
+  {
+    return x->head < y->head ? -1 : 1;
+  }
+
+  return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+/***************************************************************************/
+static int compare_unsigned(const void *a, const void *b)
+{
+  unsigned x = *(const unsigned *) a;
+  unsigned y = *(const unsigned *) b;
+
+  return x < y ? -1 : (x > y);
+}
+
+/* parse_line()
+ *
+ * Parses the given line of a text update log into 'update'. Returns 1 on
+ * success, 0 for empty lines and comments and -1 for malformed lines.
+ */
+static int parse_line(const char *line, update_t *update)
+{
+  char op;
+  char extra;
+  unsigned weight = 0;
+
+  int n = sscanf(line, " %c %u %u %u %c",
+                 &op, &update->tail, &update->head, &weight, &extra);
+
+  if (n == EOF || (n >= 1 && op == '#'))
+  {
+    return 0;
+  }
+  if (op == '+' && n == 4)
+  {
+    update->connect = true;
+    update->weight = weight;
+
+    return 1;
+  }
+  if (op == '-' && n == 3)
+  {
+    update->connect = false;
+    update->weight = 0;
+
+    return 1;
+  }
+
+  return -1;
+}
+
+/* reader_take()
+ *
+ * Converts the pending line or record of the given reader into 'update' and
+ * clears it. Returns true when this results in an update. Malformed input
+ * is counted in 'stats'.
+ */
+static bool
+reader_take(update_reader_t *reader, update_t *update,
+            graph_update_stats_t *stats)
+{
+  bool result = false;
+
+  if (reader->format == GRAPH_UPDATE_TEXT)
+  {
+    reader->pending[reader->pending_size] = '\0';
+
+    int n = reader->overflow ? -1 : parse_line(reader->pending, update);
+
+    if (n < 0)
+    {
+      stats->failed++;
+    }
+    result = n > 0;
+  }
+  else if (reader->pending_size == sizeof(graph_update_record_t))
+  {
+    graph_update_record_t record;
+
+    memcpy(&record, reader->pending, sizeof(record));
+
+    update->tail = record.tail;
+    update->head = record.head;
+    update->weight = record.weight;
+    update->connect = record.op == '+';
+
+    if (record.op == '+' || record.op == '-')
+    {
+      result = true;
+    }
+    else
+    {
+      stats->failed++;
+    }
+  }
+  else if (reader->pending_size > 0)
+  {
+    stats->failed++; /* Truncated record */
+  }
+
+  reader->pending_size = 0;
+  reader->overflow = false;
+
+  return result;
+}
+
+/* reader_read()
+ *
+ * Reads up to max_count complete updates from the stream of the given reader
+ * into 'batch'. Returns the number of updates read, which is less than
+ * max_count only when the end of the stream was reached.
+ */
+static size_t
+reader_read(update_reader_t *reader, update_t *batch, size_t max_count,
+            graph_update_stats_t *stats)
+{
+  size_t count = 0;
+  int c;
+
+  while (count < max_count && (c = getc(reader->fp)) != EOF)
+  {
+    bool complete;
+
+    if (reader->format == GRAPH_UPDATE_TEXT)
+    {
+      complete = c == '\n';
+
+      if (! complete)
+      {
+        if (reader->pending_size < sizeof(reader->pending) - 1)
+        {
+          reader->pending[reader->pending_size++] = (char) c;
+        }
+        else
+        {
+          reader->overflow = true;
+        }
+      }
+    }
+    else
+    {
+      reader->pending[reader->pending_size++] = (char) c;
+      complete = reader->pending_size == sizeof(graph_update_record_t);
+    }
+
+    if (complete && reader_take(reader, &batch[count], stats))
+    {
+      batch[count].seq = count;
+      count++;
+    }
+  }
+
+  return count;
+}
+
+/* remove_edges()
+ *
+ * Removes all edges whose head is in the sorted array 'heads' from the given
+ * adjacency list in a single walk and sets matched[k] to true when at least
+ * one edge with head heads[k] was removed. Returns the number of removed
+ * edges.
+ */
+static unsigned
+remove_edges(adjacency_list_t *list, const unsigned *heads, bool *matched,
+             size_t count)
+{
+  unsigned removed = 0;
+  edge_t **link = &list->first;
+
+  for (size_t k = 0; k < count; k++)
+  {
+    matched[k] = false;
+  }
+
+  while (*link != NULL)
+  {
+    edge_t *edge = *link;
+    const unsigned *head = bsearch(&edge->head, heads, count,
+                                   sizeof(unsigned), compare_unsigned);
+
+    if (head != NULL)
+    {
+      *link = edge->next;
+      free(edge);
+      matched[head - heads] = true;
+      removed++;
+    }
+    else
+    {
+      link = &edge->next;
+    }
+  }
+
+  return removed;
+}
+
+/* apply_batch()
+ *
+ * Applies the given batch of updates to the given graph. 'heads' and
+ * 'matched' must point to memory for at least 'count' elements.
+ */
+static void
+apply_batch(graph_t *graph, update_t *batch, size_t count, unsigned *heads,
+            bool *matched, graph_update_stats_t *stats)
+{
+  qsort(batch, count, sizeof(update_t), compare_updates);
+
+  size_t i = 0;
+
+  while (i < count)
+  {
+    unsigned tail = batch[i].tail;
+    size_t end = i;
+
+    while (end < count && batch[end].tail == tail)
+    {
+      end++;
+    }
+
+    if (tail >= graph->vertex_count)
+    {
+      stats->failed += end - i;
+      i = end;
+      continue;
+    }
+
+    /* Only the connects after the last disconnect of the same head have an
+     * effect. Mark the others as cancelled by setting their tail to an
+     * invalid vertex and collect the heads to disconnect.
+     */
+    size_t head_count = 0;
+
+    for (size_t j = end; j > i; j--)
+    {
+      update_t *update = &batch[j - 1];
+      bool disconnected =
+        head_count > 0 && heads[head_count - 1] == update->head;
+
+      if (update->head >= graph->vertex_count)
+      {
+        stats->failed++;
+        update->tail = graph->vertex_count;
+      }
+      else if (! update->connect)
+      {
+        if (! disconnected)
+        {
+          heads[head_count++] = update->head;
+        }
+      }
+      else if (disconnected)
+      {
+        stats->cancelled++;
+        update->tail = graph->vertex_count;
+      }
+    }
+
+    /* The heads were collected in descending order. */
+    for (size_t j = 0; j < head_count / 2; j++)
+    {
+      unsigned head = heads[j];
+
+      heads[j] = heads[head_count - 1 - j];
+      heads[head_count - 1 - j] = head;
+    }
+
+    if (head_count > 0)
+    {
+      graph->edge_count -= remove_edges(&graph->adjacency_lists[tail], heads,
+                                        matched, head_count);
+    }
+
+    /* Replay the updates of every head in order to find out which
+     * disconnects would have removed an edge when applied one by one: the
+     * first one does if the graph had such an edge, the others do if a
+     * (possibly cancelled) connect precedes them.
+     */
+    size_t k = 0;
+    bool present = false;
+
+    for (size_t j = i; j < end; j++)
+    {
+      const update_t *update = &batch[j];
+
+      if (update->head >= graph->vertex_count)
+      {
+        continue;
+      }
+
+      if (j == i || update->head != batch[j - 1].head)
+      {
+        present = false;
+        if (k < head_count && heads[k] == update->head)
+        {
+          present = matched[k];
+          k++;
+        }
+      }
+
+      if (update->connect)
+      {
+        present = true;
+      }
+      else
+      {
+        if (present)
+        {
+          stats->applied++;
+        }
+        else
+        {
+          stats->unmatched++;
+        }
+        present = false;
+      }
+    }
+
+    for (size_t j = i; j < end; j++)
+    {
+      if (batch[j].tail == tail && batch[j].connect)
+      {
+        if (graph_connect(graph, tail, batch[j].head, batch[j].weight))
+        {
+          stats->applied++;
+        }
+        else
+        {
+          stats->failed++;
+        }
+      }
+    }
+
+    i = end;
+  }
+}
+
+/***************************************************************************/
+bool graph_apply_updates(graph_t *graph, FILE *fp,
+                         graph_update_format_t format, unsigned follow_ms,
+                         graph_update_stats_t *stats)
+{
+  assert(graph != NULL);
+  assert(fp != NULL);
+  assert(stats != NULL);
+
+  update_t *batch = malloc(GRAPH_UPDATE_BATCH_SIZE * sizeof(update_t));
+  unsigned *heads = malloc(GRAPH_UPDATE_BATCH_SIZE * sizeof(unsigned));
+  bool *matched = malloc(GRAPH_UPDATE_BATCH_SIZE * sizeof(bool));
+
+  bool result = batch != NULL && heads != NULL && matched != NULL;
+
+  if (result)
+  {
+    update_reader_t reader;
+    reader.fp = fp;
+    reader.format = format;
+    reader.pending_size = 0;
+    reader.overflow = false;
+
+    unsigned idle_ms = 0;
+
+    for (;;)
+    {
+      size_t count = reader_read(&reader, batch, GRAPH_UPDATE_BATCH_SIZE,
+                                 stats);
+
+      if (count > 0)
+      {
+        apply_batch(graph, batch, count, heads, matched, stats);
+        idle_ms = 0;
+      }
+
+      if (ferror(fp))
+      {
+        result = false;
+        break;
+      }
+
+      if (count == GRAPH_UPDATE_BATCH_SIZE)
+      {
+        continue;
+      }
+
+      /* The end of the stream has been reached */
+      if (idle_ms >= follow_ms)
+      {
+        break;
+      }
+
+      clearerr(fp);
+      (void) usleep(GRAPH_UPDATE_POLL_MS * 1000);
+      idle_ms += GRAPH_UPDATE_POLL_MS;
+    }
+
+    /* A last line without a newline is complete once the stream ended. */
+    if (result && reader_take(&reader, &batch[0], stats))
+    {
+      apply_batch(graph, batch, 1, heads, matched, stats);
+    }
+  }
+
+  free(batch);
+  free(heads);
+  free(matched);
+
+  return result;
+}
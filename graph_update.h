@@ -0,0 +1,99 @@
+#ifndef GRAPH_UPDATE_H
+#define GRAPH_UPDATE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "graph.h"
+
+/* Maximum number of updates that are read and applied as one batch. */
+#define GRAPH_UPDATE_BATCH_SIZE 65536
+
+/* Interval in milliseconds at which a stream is polled for new updates
+ * after its end has been reached (see graph_apply_updates).
+ */
+#define GRAPH_UPDATE_POLL_MS 10
+
+/* Formats of an update log. 
+ *
+ * GRAPH_UPDATE_TEXT: one update per line, either
+ *   "+" <tail> <head> <weight>    to connect tail to head with the weight
+ *   "-" <tail> <head>             to disconnect tail from head
+ * Empty lines and lines starting with '#' are ignored.
+ *
+ * GRAPH_UPDATE_BINARY: a sequence of graph_update_record_t structures in
+ * host byte order.
+ */
+typedef enum graph_update_format_e
+{
+  GRAPH_UPDATE_TEXT,
+  GRAPH_UPDATE_BINARY
+} graph_update_format_t;
+
+/* Type representing one record of a binary update log. */
+typedef struct graph_update_record_s
+{
+  uint32_t op;     /* '+' to connect, '-' to disconnect. */
+  uint32_t tail;   /* The tail of the edge. */
+  uint32_t head;   /* The head of the edge. */
+  uint32_t weight; /* The weight of the edge, ignored by '-'. */
+} graph_update_record_t;
+
+/* Type representing the outcome of applying an update log. */
+typedef struct graph_update_stats_s
+{
+  unsigned applied; /* Number of updates that changed the graph. */
+  unsigned failed;  /* Number of malformed or unapplicable updates. */
+
+  /* Number of '-' updates that did not remove any edge, because the graph
+   * had no such edge at that point of the log.
+   */
+  unsigned unmatched;
+
+  /* Number of '+' updates that were dropped because a later '-' update in
+   * the same batch removes the edge again.
+   */
+  unsigned cancelled;
+} graph_update_stats_t;
+
+/* graph_apply_updates()
+ *
+ * Reads the update log from the stream 'fp' in the given format and applies
+ * it to the given graph.
+ *
+ * Updates are read in batches of at most GRAPH_UPDATE_BATCH_SIZE updates.
+ * Every batch is sorted by tail and head so that every adjacency list is
+ * walked at most once per batch, no matter how many edges are removed from
+ * it. The resulting graph contains the same edges as when the updates would
+ * have been applied one by one with graph_connect and graph_disconnect,
+ * although the order of the edges in the adjacency lists may differ.
+ *
+ * When follow_ms is 0 this function returns at the end of the stream. 
+ * Otherwise it keeps polling the stream for updates that are appended to it
+ * (like "tail -f") and only returns when no new updates arrived for
+ * follow_ms milliseconds. Reading from a pipe blocks until the writer
+ * closes it in both cases.
+ *
+ * The counters in 'stats' are incremented, not reset, by this function. A
+ * '-' update counts as applied when applying the updates one by one would
+ * have removed at least one edge, and as unmatched otherwise.
+ *
+ * Returns false when the dynamic memory allocation fails or when reading the
+ * stream fails. Returns true otherwise.
+ *
+ * PRECONDITIONS:
+ *   graph != NULL
+ *   fp != NULL
+ *   stats != NULL
+ *   graph is properly initialised
+ *
+ * REMARKS:
+ *  - This function only works if the implementation of graph_connect is
+ *    correct.
+ */
+bool graph_apply_updates(graph_t *graph, FILE *fp,
+                         graph_update_format_t format, unsigned follow_ms,
+                         graph_update_stats_t *stats);
+
+#endif /* GRAPH_UPDATE_H */
@@ -1,10 +1,17 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "test.h"
 #include "graph.h"
+#include "graph_update.h"
+#include "graph_bfs.h"
+#include "graph_image.h"
+#include "graph_flow.h"
+#include "graph_query.h"
+#include "graph_alloc.h"
 
 #define TEST(expr) test(expr, __FILE__, __LINE__, #expr)
 #define TESTQ(expr) testq(expr, __FILE__, __LINE__)
@@ -261,6 +268,538 @@ static void test_graph_outdegree(void)
   /* Add more tests here */
 }
 
+/****************************************************************************/
+static void test_graph_add_vertices(void)
+{
+  graph_t graph;
+  graph.vertex_count = 0;
+  graph.edge_count = 0;
+  graph.adjacency_lists = NULL;
+  graph.vertex_capacity = 0;
+  graph.free_vertices = NULL;
+  graph.free_vertex_count = 0;
+  graph.removed_vertices = NULL;
+
+  TEST(graph_add_vertices(&graph, 3));
+  TEST(graph.vertex_count == 3);
+  TEST(graph.vertex_capacity >= 3);
+
+  for (unsigned i = 0; i < 10; i++)
+  {
+    unsigned id;
+
+    TEST(graph_add_vertex(&graph, &id));
+    TEST(id == graph.vertex_count - 1);
+  }
+  TEST(graph.vertex_count == 13);
+  TEST(graph.vertex_capacity == 16);
+  TEST(graph.adjacency_lists[12].first == NULL);
+
+  free(graph.adjacency_lists);
+
+  /* Add more tests here */
+}
+
+/****************************************************************************/
+static void test_graph_remove_vertex(void)
+{
+  edge_t *edge1 = malloc(sizeof(edge_t));
+  edge_t *edge2 = malloc(sizeof(edge_t));
+  edge_t *edge3 = malloc(sizeof(edge_t));
+
+  edge1->tail = 0; edge1->head = 1; edge1->weight = 1; edge1->next = NULL;
+  edge2->tail = 1; edge2->head = 2; edge2->weight = 1; edge2->next = NULL;
+  edge3->tail = 2; edge3->head = 0; edge3->weight = 1; edge3->next = NULL;
+
+  adjacency_list_t adjacency_lists[3];
+  adjacency_lists[0].first = edge1;
+  adjacency_lists[1].first = edge2;
+  adjacency_lists[2].first = edge3;
+
+  graph_t graph;
+  graph.vertex_count = 3;
+  graph.edge_count = 3;
+  graph.adjacency_lists = adjacency_lists;
+  graph.vertex_capacity = 3;
+  graph.free_vertices = NULL;
+  graph.free_vertex_count = 0;
+  graph.removed_vertices = NULL;
+
+  TEST(graph_remove_vertex(&graph, 1));
+  TEST(graph.edge_count == 1);
+  TEST(graph.vertex_count == 3);
+  TEST(adjacency_lists[0].first == NULL);
+  TEST(adjacency_lists[1].first == NULL);
+  TEST(adjacency_lists[2].first == edge3);
+  TEST(! graph_vertex_exists(&graph, 1));
+  TEST(graph_vertex_exists(&graph, 2));
+  TEST(! graph_remove_vertex(&graph, 1));
+  TEST(graph.free_vertex_count == 1);
+  TEST(! graph_remove_vertex(&graph, 3));
+
+  unsigned id;
+  TEST(graph_add_vertex(&graph, &id));
+  TEST(id == 1);
+  TEST(graph.vertex_count == 3);
+  TEST(graph_vertex_exists(&graph, 1));
+
+  /* A batch with an invalid or repeated identifier changes nothing. */
+  unsigned repeated[2] = { 0, 0 };
+  TEST(! graph_remove_vertices(&graph, repeated, 2));
+  TEST(graph_vertex_exists(&graph, 0));
+  TEST(graph.edge_count == 1);
+
+  unsigned ids[2] = { 0, 2 };
+  TEST(graph_remove_vertices(&graph, ids, 2));
+  TEST(graph.edge_count == 0);
+  TEST(adjacency_lists[2].first == NULL);
+  TEST(! graph_vertex_exists(&graph, 0) && ! graph_vertex_exists(&graph, 2));
+  TEST(graph.free_vertex_count == 2);
+
+  free(graph.free_vertices);
+  free(graph.removed_vertices);
+
+  /* Add more tests here */
+}
+
+/****************************************************************************/
+static void test_graph_canonicalize(void)
+{
+  /* 0 -> 2 (5), 0 -> 1 (1), 0 -> 2 (3), 0 -> 0 (1), 1 -> 1 (1) */
+  unsigned heads[5] = { 2, 1, 2, 0, 1 };
+  unsigned weights[5] = { 5, 1, 3, 1, 1 };
+  edge_t *edges[5];
+
+  for (unsigned i = 0; i < 5; i++)
+  {
+    edges[i] = malloc(sizeof(edge_t));
+  }
+
+  for (unsigned i = 0; i < 5; i++)
+  {
+    edges[i]->tail = i < 4 ? 0 : 1;
+    edges[i]->head = heads[i];
+    edges[i]->weight = weights[i];
+    edges[i]->next = i < 3 ? edges[i + 1] : NULL;
+  }
+
+  adjacency_list_t adjacency_lists[3];
+  adjacency_lists[0].first = edges[0];
+  adjacency_lists[1].first = edges[4];
+  adjacency_lists[2].first = NULL;
+
+  graph_t graph;
+  graph.vertex_count = 3;
+  graph.edge_count = 5;
+  graph.adjacency_lists = adjacency_lists;
+  graph.sorted = false;
+
+  graph_canonicalize(&graph, GRAPH_MERGE_SUM, true, 2);
+
+  TEST(graph.sorted);
+  TEST(graph.edge_count == 2);
+  TEST(adjacency_lists[0].first == edges[1]);
+  TEST(edges[1]->next == edges[0]);
+  TEST(edges[0]->weight == 8);
+  TEST(edges[0]->next == NULL);
+  TEST(adjacency_lists[1].first == NULL);
+
+  free(edges[0]);
+  free(edges[1]);
+
+  /* Add more tests here */
+}
+
+/****************************************************************************/
+static void test_graph_contains(void)
+{
+  edge_t edge1;
+  edge_t edge2;
+  edge1.next = &edge2; edge1.tail = 0; edge1.head = 1; edge1.weight = 0;
+  edge2.next = NULL; edge2.tail = 0; edge2.head = 3; edge2.weight = 0;
+
+  adjacency_list_t adjacency_lists[4];
+  adjacency_lists[0].first = &edge1;
+  adjacency_lists[1].first = NULL;
+  adjacency_lists[2].first = NULL;
+  adjacency_lists[3].first = NULL;
+
+  graph_t graph;
+  graph.vertex_count = 4;
+  graph.edge_count = 2;
+  graph.adjacency_lists = adjacency_lists;
+  graph.sorted = true;
+
+  TEST(graph_contains(&graph, 0, 1));
+  TEST(graph_contains(&graph, 0, 3));
+  TEST(! graph_contains(&graph, 0, 2));
+  TEST(! graph_contains(&graph, 1, 0));
+  TEST(! graph_contains(&graph, 4, 0));
+
+  /* Add more tests here */
+}
+
+/****************************************************************************/
+static void test_graph_apply_updates(void)
+{
+  edge_t *edge1 = malloc(sizeof(edge_t));
+  edge_t *edge2 = malloc(sizeof(edge_t));
+
+  edge1->tail = 0; edge1->head = 1; edge1->weight = 1; edge1->next = edge2;
+  edge2->tail = 0; edge2->head = 2; edge2->weight = 2; edge2->next = NULL;
+
+  adjacency_list_t adjacency_lists[4];
+  adjacency_lists[0].first = edge1;
+  adjacency_lists[1].first = NULL;
+  adjacency_lists[2].first = NULL;
+  adjacency_lists[3].first = NULL;
+
+  graph_t graph;
+  graph.vertex_count = 4;
+  graph.edge_count = 2;
+  graph.adjacency_lists = adjacency_lists;
+
+  /* Only deletes and cancelled inserts, so that graph_connect is not used. */
+  char text[] = "- 0 1\n"
+                "+ 0 3 5\n"
+                "- 0 3\n"
+                "- 0 1\n"
+                "# comment\n"
+                "- 5 0\n"
+                "bogus\n";
+  graph_update_stats_t stats = { 0, 0, 0, 0 };
+
+  FILE *fp = fmemopen(text, strlen(text), "r");
+  TEST(graph_apply_updates(&graph, fp, GRAPH_UPDATE_TEXT, 0, &stats));
+  fclose(fp);
+
+  TEST(stats.applied == 2);
+  TEST(stats.failed == 2);
+  TEST(stats.unmatched == 1);
+  TEST(stats.cancelled == 1);
+  TEST(graph.edge_count == 1);
+  TEST(adjacency_lists[0].first == edge2);
+  TEST(edge2->next == NULL);
+
+  graph_update_record_t records[2] = { { '-', 0, 2, 0 }, { '-', 0, 2, 0 } };
+  memset(&stats, 0, sizeof(stats));
+
+  fp = fmemopen(records, sizeof(records), "r");
+  TEST(graph_apply_updates(&graph, fp, GRAPH_UPDATE_BINARY, 0, &stats));
+  fclose(fp);
+
+  TEST(stats.applied == 1);
+  TEST(stats.unmatched == 1);
+  TEST(graph.edge_count == 0);
+  TEST(adjacency_lists[0].first == NULL);
+
+  /* Add more tests here */
+}
+
+/****************************************************************************/
+static void test_graph_bfs_multi(void)
+{
+  edge_t edges[3];
+  edges[0].next = NULL; edges[0].tail = 0; edges[0].head = 1;
+  edges[1].next = NULL; edges[1].tail = 1; edges[1].head = 2;
+  edges[2].next = NULL; edges[2].tail = 2; edges[2].head = 0;
+
+  adjacency_list_t adjacency_lists[4];
+  adjacency_lists[0].first = &edges[0];
+  adjacency_lists[1].first = &edges[1];
+  adjacency_lists[2].first = &edges[2];
+  adjacency_lists[3].first = NULL;
+
+  graph_t graph;
+  graph.vertex_count = 4;
+  graph.edge_count = 3;
+  graph.adjacency_lists = adjacency_lists;
+  unsigned char removed_vertices = 0;
+  graph.removed_vertices = &removed_vertices;
+
+  unsigned sources[3] = { 0, 2, 3 };
+  unsigned distances[3 * 4];
+
+  TEST(graph_bfs_multi(&graph, sources, 3, distances));
+  TEST(distances[0 * 4 + 0] == 0);
+  TEST(distances[0 * 4 + 2] == 2);
+  TEST(distances[0 * 4 + 3] == GRAPH_BFS_UNREACHABLE);
+  TEST(distances[1 * 4 + 1] == 2);
+  TEST(distances[2 * 4 + 3] == 0);
+  TEST(distances[2 * 4 + 0] == GRAPH_BFS_UNREACHABLE);
+
+  /* More sources than fit in one batch */
+  unsigned many_sources[GRAPH_BFS_BATCH_SIZE + 2];
+  unsigned many_distances[(GRAPH_BFS_BATCH_SIZE + 2) * 4];
+
+  for (unsigned i = 0; i < GRAPH_BFS_BATCH_SIZE + 2; i++)
+  {
+    many_sources[i] = i % 4;
+  }
+
+  TEST(graph_bfs_multi(&graph, many_sources, GRAPH_BFS_BATCH_SIZE + 2,
+                       many_distances));
+  TEST(many_distances[(GRAPH_BFS_BATCH_SIZE + 1) * 4 + 0] == 2);
+
+  /* A removed source reaches no vertex, not even itself */
+  removed_vertices = 1u << 2;
+  TEST(graph_bfs_multi(&graph, sources, 3, distances));
+  TEST(distances[1 * 4 + 2] == GRAPH_BFS_UNREACHABLE);
+  TEST(distances[1 * 4 + 0] == GRAPH_BFS_UNREACHABLE);
+  TEST(distances[0 * 4 + 1] == 1);
+
+  /* Add more tests here */
+}
+
+/****************************************************************************/
+static void test_graph_image(void)
+{
+  edge_t edges[3];
+  edges[0].next = &edges[1]; edges[0].tail = 0; edges[0].head = 2;
+  edges[0].weight = 4;
+  edges[1].next = NULL; edges[1].tail = 0; edges[1].head = 1;
+  edges[1].weight = 3;
+  edges[2].next = NULL; edges[2].tail = 1; edges[2].head = 2;
+  edges[2].weight = 5;
+
+  adjacency_list_t adjacency_lists[3];
+  adjacency_lists[0].first = &edges[0];
+  adjacency_lists[1].first = &edges[2];
+  adjacency_lists[2].first = NULL;
+
+  graph_t graph;
+  graph.vertex_count = 3;
+  graph.edge_count = 3;
+  graph.adjacency_lists = adjacency_lists;
+
+  graph_image_t image;
+
+  TEST(graph_image_publish(&graph, "test.img"));
+  TEST(graph_image_attach(&image, "test.img"));
+  TEST(image.vertex_count == 3);
+  TEST(image.edge_count == 3);
+  TEST(graph_image_outdegree(&image, 0) == 2);
+  TEST(graph_image_indegree(&image, 2) == 2);
+  TEST(graph_image_contains(&image, 0, 1));
+  TEST(! graph_image_contains(&image, 1, 0));
+
+  const uint32_t *heads;
+  const uint32_t *weights;
+  TEST(graph_image_neighbours(&image, 0, &heads, &weights) == 2);
+  TEST(heads[0] == 1 && weights[0] == 3);
+  TEST(heads[1] == 2 && weights[1] == 4);
+
+  /* Publishing a new generation leaves the attached image intact */
+  adjacency_lists[1].first = NULL;
+  TEST(graph_image_is_current(&image, "test.img"));
+  TEST(graph_image_publish(&graph, "test.img"));
+  TEST(! graph_image_is_current(&image, "test.img"));
+  TEST(graph_image_outdegree(&image, 1) == 1);
+
+  graph_image_t next;
+  TEST(graph_image_attach(&next, "test.img"));
+  TEST(next.generation == image.generation + 1);
+  TEST(graph_image_outdegree(&next, 1) == 0);
+
+  graph_image_detach(&next);
+  graph_image_detach(&image);
+  (void) unlink("test.img");
+
+  /* Add more tests here */
+}
+
+/****************************************************************************/
+static void test_graph_max_flow(void)
+{
+  /* 0 -> 1 (3), 0 -> 2 (2), 1 -> 2 (5), 1 -> 3 (2), 2 -> 3 (3) */
+  edge_t edges[5];
+  edges[0].next = &edges[1]; edges[0].tail = 0; edges[0].head = 1;
+  edges[0].weight = 3;
+  edges[1].next = NULL; edges[1].tail = 0; edges[1].head = 2;
+  edges[1].weight = 2;
+  edges[2].next = &edges[3]; edges[2].tail = 1; edges[2].head = 2;
+  edges[2].weight = 5;
+  edges[3].next = NULL; edges[3].tail = 1; edges[3].head = 3;
+  edges[3].weight = 2;
+  edges[4].next = NULL; edges[4].tail = 2; edges[4].head = 3;
+  edges[4].weight = 3;
+
+  adjacency_list_t adjacency_lists[4];
+  adjacency_lists[0].first = &edges[0];
+  adjacency_lists[1].first = &edges[2];
+  adjacency_lists[2].first = &edges[4];
+  adjacency_lists[3].first = NULL;
+
+  graph_t graph;
+  graph.vertex_count = 4;
+  graph.edge_count = 5;
+  graph.adjacency_lists = adjacency_lists;
+
+  uint64_t flow = 0;
+  bool source_side[4];
+
+  TEST(graph_max_flow(&graph, 0, 3, &flow, source_side));
+  TEST(flow == 5);
+  TEST(source_side[0] && source_side[1] && source_side[2]);
+  TEST(! source_side[3]);
+
+  TEST(graph_max_flow(&graph, 3, 0, &flow, NULL));
+  TEST(flow == 0);
+  TEST(! graph_max_flow(&graph, 0, 0, &flow, NULL));
+  TEST(! graph_max_flow(&graph, 0, 4, &flow, NULL));
+
+  flow = 0;
+  TEST(graph_max_flow_parallel(&graph, 0, 3, &flow, source_side, 4));
+  TEST(flow == 5);
+  TEST(source_side[0] && source_side[1] && source_side[2]);
+  TEST(! source_side[3]);
+  TEST(graph_max_flow_parallel(&graph, 1, 3, &flow, NULL, 0));
+  TEST(flow == 5);
+  TEST(! graph_max_flow_parallel(&graph, 0, 0, &flow, NULL, 2));
+
+  /* Add more tests here */
+}
+
+/****************************************************************************/
+static void test_graph_khop(void)
+{
+  /* 0 -> 1, 0 -> 2, 1 -> 2, 2 -> 3 */
+  edge_t edges[4];
+  edges[0].next = &edges[1]; edges[0].tail = 0; edges[0].head = 1;
+  edges[0].weight = 1;
+  edges[1].next = NULL; edges[1].tail = 0; edges[1].head = 2;
+  edges[1].weight = 2;
+  edges[2].next = NULL; edges[2].tail = 1; edges[2].head = 2;
+  edges[2].weight = 3;
+  edges[3].next = NULL; edges[3].tail = 2; edges[3].head = 3;
+  edges[3].weight = 4;
+
+  adjacency_list_t adjacency_lists[4];
+  adjacency_lists[0].first = &edges[0];
+  adjacency_lists[1].first = &edges[2];
+  adjacency_lists[2].first = &edges[3];
+  adjacency_lists[3].first = NULL;
+
+  graph_t graph;
+  graph.vertex_count = 4;
+  graph.edge_count = 4;
+  graph.adjacency_lists = adjacency_lists;
+  unsigned char removed_vertices = 0;
+  graph.removed_vertices = &removed_vertices;
+
+  graph_query_t query;
+  TEST(graph_query_initialise(&query, 4, 8));
+
+  TEST(graph_khop(&query, &graph, 0, 1, 0) == 3);
+  TEST(query.vertices[0] == 0 && query.depths[0] == 0);
+  TEST(query.depths[2] == 1);
+  TEST(! query.truncated);
+
+  TEST(graph_khop(&query, &graph, 0, 2, 0) == 4);
+  TEST(query.vertices[3] == 3 && query.depths[3] == 2);
+
+  TEST(graph_khop(&query, &graph, 0, 1, 1) == 2);
+  TEST(query.truncated);
+
+  TEST(graph_khop(&query, &graph, 4, 1, 0) == 0);
+
+  /* A removed source reaches no vertex */
+  removed_vertices = 1u << 1;
+  TEST(graph_khop(&query, &graph, 1, 1, 0) == 0);
+  TEST(query.vertex_count == 0);
+  removed_vertices = 0;
+
+  /* Subgraph induced on { 0, 1, 2 } */
+  TEST(graph_khop(&query, &graph, 0, 1, 0) == 3);
+  TEST(graph_induced_subgraph(&query, &graph, 0));
+  TEST(query.edge_count == 3);
+  TEST(query.offsets[1] - query.offsets[0] == 2);
+  TEST(query.offsets[2] - query.offsets[1] == 1);
+  TEST(query.offsets[3] - query.offsets[2] == 0);
+  TEST(query.vertices[query.heads[query.offsets[1]]] == 2);
+  TEST(query.weights[query.offsets[1]] == 3);
+
+  unsigned vertices[3] = { 3, 2, 3 };
+  TEST(graph_query_set_vertices(&query, vertices, 3) == 2);
+  TEST(graph_induced_subgraph(&query, &graph, 0));
+  TEST(query.edge_count == 1);
+  TEST(query.heads[0] == 0);
+
+  graph_query_release(&query);
+
+  /* Add more tests here */
+}
+
+/****************************************************************************/
+static void test_graph_place(void)
+{
+  edge_t edges[3];
+  edges[0].next = &edges[1]; edges[0].tail = 0; edges[0].head = 2;
+  edges[0].weight = 4;
+  edges[1].next = NULL; edges[1].tail = 0; edges[1].head = 1;
+  edges[1].weight = 3;
+  edges[2].next = NULL; edges[2].tail = 2; edges[2].head = 0;
+  edges[2].weight = 5;
+
+  adjacency_list_t adjacency_lists[3];
+  adjacency_lists[0].first = &edges[0];
+  adjacency_lists[1].first = NULL;
+  adjacency_lists[2].first = &edges[2];
+
+  graph_t graph;
+  graph.vertex_count = 3;
+  graph.edge_count = 3;
+  graph.adjacency_lists = adjacency_lists;
+  graph.sorted = false;
+
+  graph_alloc_policy_t policies[3] =
+  {
+    { GRAPH_PAGES_DEFAULT, GRAPH_PLACE_FIRST_TOUCH },
+    { GRAPH_PAGES_TRANSPARENT, GRAPH_PLACE_INTERLEAVE },
+    { GRAPH_PAGES_EXPLICIT, GRAPH_PLACE_PARTITION },
+  };
+
+  TEST(graph_alloc_node_count() >= 1);
+
+  for (unsigned i = 0; i < 3; i++)
+  {
+    graph_t placed;
+
+    TEST(graph_place(&graph, &placed, &policies[i]));
+    TEST(placed.vertex_count == 3);
+    TEST(placed.edge_count == 3);
+
+    edge_t *first = placed.adjacency_lists[0].first;
+    TEST(first != NULL && first != &edges[0]);
+    if (first != NULL)
+    {
+      TEST(first->head == 2 && first->weight == 4);
+      TEST(first->next == first + 1);
+      TEST(first->next->head == 1 && first->next->next == NULL);
+    }
+    TEST(placed.adjacency_lists[1].first == NULL);
+    TEST(placed.adjacency_lists[2].first != NULL);
+
+    /* Three adjacency lists share one page, so they form the only range. */
+    unsigned bounds[graph_alloc_node_count() + 1];
+    unsigned nodes[graph_alloc_node_count()];
+    TEST(graph_place_ranges(&placed, bounds, nodes) == 1);
+    TEST(bounds[0] == 0 && bounds[1] == 3);
+    TEST(nodes[0] < graph_alloc_node_count());
+
+    /* Huge page backed edges start on a huge page boundary. */
+    if (policies[i].pages != GRAPH_PAGES_DEFAULT)
+    {
+      TEST((uintptr_t) first % (2u << 20) == 0);
+    }
+
+    graph_place_release(&placed);
+    TEST(placed.adjacency_lists == NULL);
+  }
+
+  /* Add more tests here */
+}
+
 /****************************************************************************/
 void student_test(void)
 {
@@ -277,6 +816,16 @@ void student_test(void)
   test_graph_connect();
   test_graph_disconnect();
   test_graph_outdegree();
+  test_graph_add_vertices();
+  test_graph_remove_vertex();
+  test_graph_canonicalize();
+  test_graph_contains();
+  test_graph_apply_updates();
+  test_graph_bfs_multi();
+  test_graph_image();
+  test_graph_max_flow();
+  test_graph_khop();
+  test_graph_place();
 
   fprintf(stdout, "%d tests passed\n", stats.pass);
   fprintf(stdout, "%d tests failed\n", stats.fail);